@@ -7,7 +7,9 @@ to one central authority (the Codex) and use strings containing the UUIDs to
 retrieve raw pointers.
 Since ownership is managed by the Codex, you are not allowed to delete any raw
 pointers to Things.
-The Codex maps std::string UUIDs to std::unique_ptr<Thing>.
+The Codex maps UUIDs to std::unique_ptr<Thing>. Internally UUIDs are stored as
+16 byte binary values (dh::codex::Uuid), the string representation is only used
+at the edges of the API.
 
 Taking a parent-child relationship as an example, instead of the parent owning
 the child, both are owned by the Codex. To make the relationship, the parent
@@ -18,15 +20,82 @@ Both can have methods <std::vector<Thing*>> get_children() and <Thing* get_paren
 respectively, retrieving a raw pointer to the respective objects. This method
 allows circular relationships, composition and aggregation, many-to-many, one-to-many,
 many-to-one and one-to-one relationships.
-Thing provides a _on_remove() method which can/should be overwritten in subclasses
-to update other nodes with dependencies to the node being deleted. In case of a
-parent-child relationship, if the child gets removed, its UUID should be removed
-from the parent's children list. Or if the parent gets removed, the child should
-be removed as well.
+Thing provides on_remove() and on_remove_batch() methods which can/should be
+overwritten in subclasses to update other nodes with dependencies to the node being
+removed. They are called after the Thing has been unlinked from the Codex, right
+before it gets destroyed. In case of a parent-child relationship, if the child gets
+removed, its UUID should be removed from the parent's children list. Or if the
+parent gets removed, the child should be removed as well (see remove_cascade()).
+References recorded with link() are indexed in both directions, so a removed Thing's
+referrers are told through on_referent_removed() without searching for them.
+For many-to-many graphs, relation() gives a Codex managed relationship store that
+keeps each Thing's neighbors in one contiguous block, see neighbors().
+Ref<T> keeps a UUID together with the pointer it last resolved to, so following it
+again only costs a lookup if a Thing has been removed in the meantime.
+bfs(), dfs(), reachable_from() and subtree() walk everything reachable from a Thing,
+along a relation or any other edges the Things report.
+Alternatively, Things report their references through visit_refs() and collect()
+removes everything that can't be reached from the roots registered with add_root(),
+cycles included.
+
+The free functions all work on one default Codex. Subsystems that shouldn't share
+it (or its locks) can create a Codex of their own, see Codex.
+A Session locks a Codex once for a whole block of operations and can commit or
+roll back the adds and removes made through it.
 
 The Codex does not provide a direct implementation for hierarchies since the needs
 can vary, but it should provide a base to implement your system.
 
+Build options (define before including this header):
+    DH_CODEX_SHARDS <N>     Splits the Codex into N independently locked shards
+                            (power of two, max 64). Things are assigned to a shard
+                            by the hash of their UUID.
+    DH_CODEX_LOCKFREE_READS get() and get__unsafe() never block. Lookups go through
+                            a concurrent index and removed Things are only destroyed
+                            once no reader can still see them (epoch based
+                            reclamation), so while other threads are reading, the
+                            destructor (and any cascading removal in it) may run
+                            after remove() returned. Mutators keep locking as usual.
+    DH_CODEX_SYSTEM_UUID    Generates UUIDs through the operating system (libuuid on
+                            linux, UuidCreate on windows) instead of the built in
+                            per thread generator.
+    DH_CODEX_UUID_V7        Generates time ordered UUIDs (version 7) with the built in
+                            generator. Things created one after another get
+                            neighbouring UUIDs and list_entries() prints the Codex in
+                            creation order. Takes precedence over DH_CODEX_SYSTEM_UUID.
+    DH_CODEX_SEQUENTIAL_UUID
+                            Generates UUIDs by counting up from a random per thread
+                            prefix (version 8). Cheapest to generate, but consecutive
+                            UUIDs are predictable. Takes precedence over
+                            DH_CODEX_SYSTEM_UUID, can't be combined with
+                            DH_CODEX_UUID_V7.
+    DH_CODEX_BACKGROUND_RECLAIM
+                            Removed Things are destroyed on a background thread
+                            instead of the thread that removed them, so remove()
+                            returns before the destructor ran. reclaim() waits for
+                            the background thread to catch up.
+    DH_CODEX_SHARED_MUTEX   Replaces the mutex with a writer preferring reader/writer
+                            lock. get(), size() and list_entries() take shared
+                            ownership, add() and remove() exclusive ownership.
+                            Don't add or remove Things from within get_repr() in
+                            this mode, list_entries() only holds a shared lock.
+    DH_CODEX_SINGLE_THREADED
+                            Replaces all locks of the Codex with empty ones, for
+                            programs that only ever use it from one thread at a time.
+                            The lock bookkeeping that keeps nested calls (eg remove()
+                            from within a destructor) working stays in place. Can't
+                            be combined with DH_CODEX_SHARED_MUTEX,
+                            DH_CODEX_LOCKFREE_READS or DH_CODEX_BACKGROUND_RECLAIM.
+
+The locking mode and the UUID scheme are build options, not template parameters of
+Codex: the free functions, Thing, Ref, Handle and the removal machinery all share
+one set of internals, so a Codex<LockPolicy, ..., IdPolicy> template would turn
+every one of them into a template as well. The flip side is that all Codices in a
+program use the same configuration, and that every translation unit has to
+include this header with the same options. The storage isn't configurable at all:
+Things always live in a FlatMap keyed by their binary UUID, with the SlotArray
+behind Handles for dense access. String keys and ordered maps aren't offered.
+
 =====================================================================================
 MIT License
 
@@ -58,11 +127,75 @@ SOFTWARE.
 #define DH_CODEX_IMPLEMENTATION
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
 #include <string>
 #include <mutex>
+#include <new>
+#include <thread>
 #include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+#ifdef DH_CODEX_SYSTEM_UUID
+#if defined(_WIN32)
+#pragma comment(lib, "rpcrt4.lib")
+#include <Rpc.h>
+#elif defined(__linux__) || defined(__APPLE__)
+#include <uuid/uuid.h>
+#endif
+#endif
+
+// Number of independently locked shards the Codex is split into (power of two, max 64).
+// With the default of 1, the Codex is a single map behind a single mutex.
+#ifndef DH_CODEX_SHARDS
+#define DH_CODEX_SHARDS 1
+#endif
+
+// Define DH_CODEX_LOCKFREE_READS to make get() and get__unsafe() lock free, see above.
+
+/**
+ * @brief Registers a subclass of Thing with the Codex's type information
+ *
+ * Put this at the top of the class body, `BASE` being the direct base class (which
+ * has to be registered as well, Thing is by default). get<T>() and thing_cast<T>()
+ * then check the type in constant time and use a static_cast instead of a
+ * dynamic_cast. Unregistered classes still work, they are checked through
+ * dynamic_cast. Thing must not be a virtual base of registered classes.
+ * This speeds up the cast, not the lookup: get<T>() is mostly hashing and locking,
+ * the gain shows where pointers get cast a lot (see typed_get in the benchmarks).
+ * Like Q_OBJECT, the macro leaves the class at `private:` access.
+*/
+#define DH_CODEX_THING(CLASS, BASE)                                                                       \
+public:                                                                                                   \
+    using _dh_codex_self = CLASS;                                                                         \
+    static const ::dh::codex::TypeInfo* static_type_info() {                                              \
+        static_assert(std::is_base_of<BASE, CLASS>::value, #CLASS " must derive from " #BASE);            \
+        static_assert(std::is_same<typename BASE::_dh_codex_self, BASE>::value,                            \
+                      #BASE " must be registered with DH_CODEX_THING as well");                           \
+        static const ::dh::codex::TypeInfo info{ #CLASS, BASE::static_type_info() };                      \
+        return &info;                                                                                     \
+    }                                                                                                     \
+    const ::dh::codex::TypeInfo* get_type_info() const override { return static_type_info(); }            \
+private:
 
 
 namespace dh {
@@ -70,17 +203,458 @@ namespace codex {
     // this will be defined later
     class Thing;
 
+    /**
+     * @brief Binary representation of a UUID
+     *
+     * The 16 bytes are stored as two 64 bit words in network order, so `hi` holds
+     * the first 8 bytes of the canonical string and `lo` the last 8. Comparing and
+     * hashing a Uuid therefore boils down to two 64 bit operations and, unlike a
+     * 36 character std::string, it never allocates.
+     * Conversion from and to the canonical string only happens at the edges of the
+     * API (eg get_uuid(), list_entries()).
+    */
+    struct Uuid {
+        uint64_t hi = 0;
+        uint64_t lo = 0;
+
+        /**
+         * @brief Builds a Uuid from 16 raw bytes (eg a libuuid uuid_t)
+         *
+         * @param bytes Pointer to 16 bytes
+         *
+         * @return Uuid
+        */
+        static Uuid from_bytes(const unsigned char* bytes) {
+            Uuid uuid;
+            for (int idx = 0; idx < 8; idx++) uuid.hi = (uuid.hi << 8) | bytes[idx];
+            for (int idx = 8; idx < 16; idx++) uuid.lo = (uuid.lo << 8) | bytes[idx];
+            return uuid;
+        }
+
+        /**
+         * @brief Parses the canonical 8-4-4-4-12 string representation
+         *
+         * Upper and lower case hex digits are accepted.
+         *
+         * @param str The string to parse
+         *
+         * @return The parsed Uuid or a nil Uuid if the string is malformed
+        */
+        static Uuid from_string(const std::string& str) {
+            if (str.size() != 36) return Uuid();
+            Uuid uuid;
+            int digits = 0;
+            for (size_t idx = 0; idx < str.size(); idx++) {
+                const char c = str[idx];
+                if (idx == 8 || idx == 13 || idx == 18 || idx == 23) {
+                    if (c != '-') return Uuid();
+                    continue;
+                }
+                uint64_t nibble;
+                if (c >= '0' && c <= '9') nibble = c - '0';
+                else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+                else return Uuid();
+
+                uint64_t& word = (digits < 16) ? uuid.hi : uuid.lo;
+                word = (word << 4) | nibble;
+                digits++;
+            }
+            return uuid;
+        }
+
+        /**
+         * @brief Writes the 16 raw bytes
+         *
+         * @param bytes Pointer to a buffer of at least 16 bytes
+        */
+        void to_bytes(unsigned char* bytes) const {
+            for (int idx = 0; idx < 8; idx++) bytes[idx] = (unsigned char)(this->hi >> (56 - 8 * idx));
+            for (int idx = 0; idx < 8; idx++) bytes[8 + idx] = (unsigned char)(this->lo >> (56 - 8 * idx));
+        }
+
+        /**
+         * @brief Canonical (lower case) string representation
+         *
+         * @return eg "0f8fad5b-d9cb-469f-a165-70867728950e"
+        */
+        std::string to_string() const {
+            static const char* hex = "0123456789abcdef";
+            std::string str(36, '-');
+            int digit = 0;
+            for (size_t idx = 0; idx < str.size(); idx++) {
+                if (idx == 8 || idx == 13 || idx == 18 || idx == 23) continue;
+                const uint64_t word = (digit < 16) ? this->hi : this->lo;
+                str[idx] = hex[(word >> (60 - 4 * (digit % 16))) & 0xf];
+                digit++;
+            }
+            return str;
+        }
+
+        /**
+         * @brief Generates a new UUID
+         *
+         * Same generator Thing uses for its UUID, see DH_CODEX_SYSTEM_UUID and
+         * DH_CODEX_UUID_V7.
+        */
+        static Uuid generate();
+
+        /**
+         * @brief Generates a new time ordered (version 7) UUID, regardless of build options
+        */
+        static Uuid generate_v7();
+
+        /**
+         * @brief The version field (eg 4 for random, 7 for time ordered UUIDs)
+        */
+        int version() const { return (int)((this->hi >> 12) & 0xf); }
+
+        /**
+         * @brief Whether this is the nil UUID (all zeros)
+        */
+        bool is_nil() const { return (this->hi | this->lo) == 0; }
+
+        /**
+         * @brief Mixes both words into a hash
+         *
+         * Random (v4) UUIDs would hash fine with a simple xor, but the mixing
+         * keeps the distribution sane for time ordered or sequential ids as well.
+        */
+        size_t hash() const {
+            uint64_t h = this->hi ^ (this->lo * 0x9E3779B97F4A7C15ull);
+            h ^= h >> 32;
+            h *= 0xD6E8FEB86659FD93ull;
+            h ^= h >> 32;
+            return (size_t)h;
+        }
+
+        bool operator==(const Uuid& other) const { return this->hi == other.hi && this->lo == other.lo; }
+        bool operator!=(const Uuid& other) const { return !(*this == other); }
+        bool operator<(const Uuid& other) const {
+            return (this->hi != other.hi) ? this->hi < other.hi : this->lo < other.lo;
+        }
+    };
+
+    static_assert(sizeof(Uuid) == 16, "Uuid must be 16 bytes");
+    static_assert(std::is_trivially_copyable<Uuid>::value, "Uuid must be trivially copyable");
+
+    /**
+     * @brief Read only view of contiguous elements, a stand-in for C++20's std::span
+    */
+    template <typename T>
+    class Span {
+    private:
+        const T* _data = nullptr;
+        size_t _size = 0;
+
+    public:
+        Span() = default;
+        Span(const T* data, size_t size) : _data(data), _size(size) {}
+
+        const T* data() const { return this->_data; }
+        size_t size() const { return this->_size; }
+        bool empty() const { return this->_size == 0; }
+        const T& operator[](size_t idx) const { return this->_data[idx]; }
+        const T* begin() const { return this->_data; }
+        const T* end() const { return this->_data + this->_size; }
+    };
+
+    /**
+     * @brief Names a kind of relationship between Things, see relation()
+    */
+    struct Relation {
+        uint32_t id = 0;
+
+        Relation() = default;
+        explicit Relation(uint32_t id) : id(id) {}
+
+        bool operator==(const Relation& other) const { return this->id == other.id; }
+        bool operator!=(const Relation& other) const { return this->id != other.id; }
+    };
+
+    /**
+     * @brief Compact, generation checked reference to a Thing
+     *
+     * A 32 bit slot index plus a 32 bit generation. Resolving a Handle is one indexed
+     * load into the Codex's slot array plus a comparison of the generation, instead
+     * of a hash lookup by UUID. Once the Thing is removed, its slot's generation moves
+     * on and the Handle resolves to nullptr, even if the slot gets reused.
+     * Handles are only valid for the lifetime of the process, use the UUID whenever
+     * a reference has to be persisted.
+     *
+     * @tparam T The type of Thing referenced
+    */
+    template<typename T = Thing>
+    struct Handle {
+        uint32_t index = 0;
+        uint32_t generation = 0;    // 0 is never handed out, so a default Handle is null
+
+        Handle() = default;
+        Handle(uint32_t index, uint32_t generation) : index(index), generation(generation) {}
+
+        // Handle<Derived> converts to Handle<Base>
+        template<typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+        Handle(const Handle<U>& other) : index(other.index), generation(other.generation) {}
+
+        bool is_null() const { return this->generation == 0; }
+        explicit operator bool() const { return !this->is_null(); }
+
+        bool operator==(const Handle& other) const { return this->index == other.index && this->generation == other.generation; }
+        bool operator!=(const Handle& other) const { return !(*this == other); }
+    };
+
+    /**
+     * @brief Lightweight runtime type information for Things
+     *
+     * Every class registered with DH_CODEX_THING owns one TypeInfo holding the chain of
+     * its registered ancestors indexed by depth, Thing being depth 0. Checking whether
+     * an object is a T is a single compare, ancestors[depth of T] == TypeInfo of T, no
+     * matter how deep the hierarchy is.
+    */
+    class TypeInfo {
+    private:
+        const char* _name;
+        uint32_t _depth;
+        std::unique_ptr<const TypeInfo*[]> _ancestors;
+
+    public:
+        TypeInfo(const char* name, const TypeInfo* parent)
+            : _name(name), _depth((parent != nullptr) ? parent->_depth + 1 : 0), _ancestors(new const TypeInfo*[this->_depth + 1]) {
+            for (uint32_t idx = 0; idx < this->_depth; idx++) this->_ancestors[idx] = parent->_ancestors[idx];
+            this->_ancestors[this->_depth] = this;
+        }
+        TypeInfo(const TypeInfo&) = delete;
+        TypeInfo& operator=(const TypeInfo&) = delete;
+
+        const char* name() const { return this->_name; }
+        uint32_t depth() const { return this->_depth; }
+        const TypeInfo* parent() const { return (this->_depth > 0) ? this->_ancestors[this->_depth - 1] : nullptr; }
+
+        /**
+         * @brief Whether this type is `other` or derives from it
+        */
+        bool is_a(const TypeInfo* other) const {
+            return other->_depth <= this->_depth && this->_ancestors[other->_depth] == other;
+        }
+    };
+
+    template <typename T> T* thing_cast(Thing* thing);
+    template <typename T, typename... Args> T* emplace(Args&&... args);
+
+    // gives the Codex internals access to Thing's private bookkeeping
+    class ThingAccess;
+
+    class Codex;
+    // gives the Codex internals access to Codex's private state
+    class CodexAccess;
+
+    /**
+     * @brief The state of a Codex, only ever used through a pointer, see Codex
+    */
+    class CodexState {
+    public:
+        virtual ~CodexState() {}
+    };
+
+    /**
+     * @brief The locks and pending changes of a Session, only ever used through a pointer, see Session
+    */
+    class SessionState {
+    public:
+        virtual ~SessionState() {}
+    };
+
 // internal stuff, no need to expose that to users
-namespace {
-#ifdef __APPLE__
-#error __new_uuid() not implemented for apple yet!
-    // apple implementation of _new_uuid()
-    const std::string _new_uuid() {}
+// Named rather than anonymous, so all translation units share one default Codex and
+// the same per thread state
+namespace detail {
+    /**
+     * @brief Fast per thread UUID generator
+     *
+     * xoshiro256** seeded once per thread from std::random_device, the clock and the
+     * thread's identity. Generating a UUID is a handful of arithmetic instructions:
+     * no syscall, no lock and no allocation.
+     * This is a statistical PRNG, not a cryptographic one. UUIDs are meant to be
+     * unique, not secret, so that's fine for the Codex. If you need UUIDs from the
+     * operating system, define DH_CODEX_SYSTEM_UUID.
+     * After fork(), the child reseeds so it doesn't repeat the parent's sequence.
+    */
+    class UuidGenerator {
+    private:
+        static constexpr int kV7CounterBits = 42;
+        static constexpr uint64_t kSequentialCounterMask = (1ull << 62) - 1;
 
-#elif defined(_WIN32)
-    #pragma comment(lib, "rpcrt4.lib")
-    #include <Rpc.h>
+        uint64_t _state[4];
+        unsigned _fork_generation = 0;
+        uint64_t _v7_millis = 0;
+        uint64_t _v7_counter = 0;
+        uint64_t _sequential_prefix = 0;
+        uint64_t _sequential_counter = kSequentialCounterMask;    // draws a prefix on first use
+
+        static uint64_t _rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        static uint64_t _splitmix(uint64_t& x) {
+            uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        static std::atomic<unsigned>& _forks() {
+            static std::atomic<unsigned> forks{ 0 };
+#if defined(__unix__) || defined(__APPLE__)
+            static const bool registered = (pthread_atfork(nullptr, nullptr, []() { _forks()++; }) == 0);
+            (void)registered;
+#endif
+            return forks;
+        }
 
+        void _seed() {
+            uint64_t seed = (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+            seed ^= (uint64_t)std::hash<std::thread::id>()(std::this_thread::get_id()) << 1;
+            seed ^= (uint64_t)(uintptr_t)this;
+            try {
+                std::random_device device;
+                seed ^= ((uint64_t)device() << 32) ^ device();
+            }
+            catch (...) {
+                // no entropy source, the clock and thread identity have to do
+            }
+            for (int idx = 0; idx < 4; idx++) this->_state[idx] = _splitmix(seed);
+            this->_fork_generation = _forks().load(std::memory_order_relaxed);
+            this->_sequential_counter = kSequentialCounterMask;
+        }
+
+    public:
+        UuidGenerator() { this->_seed(); }
+
+        uint64_t next() {
+            if (this->_fork_generation != _forks().load(std::memory_order_relaxed)) this->_seed();
+            uint64_t* s = this->_state;
+            const uint64_t result = _rotl(s[1] * 5, 7) * 9;
+            const uint64_t t = s[1] << 17;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = _rotl(s[3], 45);
+            return result;
+        }
+
+        /**
+         * @brief Random (version 4, RFC 4122 variant) UUID
+        */
+        Uuid v4() {
+            Uuid uuid;
+            uuid.hi = (this->next() & ~0xF000ull) | 0x4000ull;
+            uuid.lo = (this->next() & 0x3FFFFFFFFFFFFFFFull) | 0x8000000000000000ull;
+            return uuid;
+        }
+
+        /**
+         * @brief Time ordered (version 7, RFC 9562) UUID
+         *
+         * 48 bit unix timestamp in milliseconds, followed by a 42 bit counter (the
+         * 12 bits of rand_a and the top 30 bits of rand_b) and 32 random bits.
+         * The counter starts at a random value in its lower half every millisecond
+         * and counts up from there, so UUIDs generated by the same thread are strictly
+         * increasing. Should it ever run out, the timestamp moves on a millisecond early.
+        */
+        Uuid v7() {
+            const uint64_t counter_mask = (1ull << kV7CounterBits) - 1;
+            const uint64_t now = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+
+            if (now > this->_v7_millis) {
+                this->_v7_millis = now;
+                this->_v7_counter = this->next() & (counter_mask >> 1);
+            }
+            else if (++this->_v7_counter > counter_mask) {
+                // clock went backwards or more than 2^41 UUIDs in one millisecond
+                this->_v7_millis++;
+                this->_v7_counter = this->next() & (counter_mask >> 1);
+            }
+
+            Uuid uuid;
+            uuid.hi = ((this->_v7_millis & 0xFFFFFFFFFFFFull) << 16) | 0x7000ull | (this->_v7_counter >> 30);
+            uuid.lo = 0x8000000000000000ull | ((this->_v7_counter & 0x3FFFFFFFull) << 32) | (this->next() & 0xFFFFFFFFull);
+            return uuid;
+        }
+
+        /**
+         * @brief Sequential (version 8, RFC 9562) UUID
+         *
+         * A random 60 bit prefix drawn once per thread, followed by a 62 bit counter.
+         * Consecutive UUIDs of a thread only differ in the counter, so generating one
+         * costs an increment instead of two rounds of the PRNG. The prefix is drawn
+         * again should the counter ever run out, and after fork().
+        */
+        Uuid sequential() {
+            if (this->_fork_generation != _forks().load(std::memory_order_relaxed)) this->_seed();
+            if (this->_sequential_counter == kSequentialCounterMask) {
+                this->_sequential_prefix = (this->next() & ~0xF000ull) | 0x8000ull;
+                this->_sequential_counter = 0;
+            }
+            Uuid uuid;
+            uuid.hi = this->_sequential_prefix;
+            uuid.lo = 0x8000000000000000ull | ++this->_sequential_counter;
+            return uuid;
+        }
+    };
+
+    /**
+     * @brief The calling thread's UuidGenerator
+    */
+    inline UuidGenerator& _get_uuid_generator() {
+        thread_local UuidGenerator generator;
+        return generator;
+    }
+
+#if defined(DH_CODEX_UUID_V7) && defined(DH_CODEX_SEQUENTIAL_UUID)
+#error "DH_CODEX_UUID_V7 and DH_CODEX_SEQUENTIAL_UUID can't be combined"
+#endif
+
+#if defined(DH_CODEX_SEQUENTIAL_UUID)
+    /**
+     * @brief Generates a new UUID, counting up from a random per thread prefix
+     * 
+     * The UUID is used as key into the codex to retrieve the object. Its also supposed
+     * to be used to create 'soft' relationships.
+     * 
+     * @return UUID
+    */
+    inline const Uuid _new_uuid() {
+        return _get_uuid_generator().sequential();
+    }
+
+#elif defined(DH_CODEX_UUID_V7)
+    /**
+     * @brief Generates a new, time ordered UUID
+     * 
+     * The UUID is used as key into the codex to retrieve the object. Its also supposed
+     * to be used to create 'soft' relationships.
+     * 
+     * @return UUID
+    */
+    inline const Uuid _new_uuid() {
+        return _get_uuid_generator().v7();
+    }
+
+#elif !defined(DH_CODEX_SYSTEM_UUID)
+    /**
+     * @brief Generates a new UUID
+     * 
+     * The UUID is used as key into the codex to retrieve the object. Its also supposed
+     * to be used to create 'soft' relationships.
+     * 
+     * @return UUID
+    */
+    inline const Uuid _new_uuid() {
+        return _get_uuid_generator().v4();
+    }
+
+#elif defined(_WIN32)
     /**
      * @brief Generates a new UUID
      * 
@@ -89,28 +663,22 @@ namespace {
      * 
      * @return UUID
     */
-    const std::string _new_uuid()
+    inline const Uuid _new_uuid()
     {
         UUID uuid;
         long status = UuidCreate(&uuid);
         if (status != 0) {
             std::cout << "Unexpected error retrieveing UUID! Error code: " << status << std::endl;
-            return "";
-        }
-        unsigned char* str;
-        status = UuidToStringA(&uuid, &str);
-        if (status != 0) {
-            std::cout << "Unexpected error converting UUID to string! Error code: " << status << std::endl;
-            return "";
+            return Uuid();
         }
-        std::string s((char*)str);
-        RpcStringFreeA(&str);
-        return s;
+        // Data1-3 are native integers, the canonical string prints them big endian
+        Uuid result;
+        result.hi = ((uint64_t)uuid.Data1 << 32) | ((uint64_t)uuid.Data2 << 16) | (uint64_t)uuid.Data3;
+        for (int idx = 0; idx < 8; idx++) result.lo = (result.lo << 8) | uuid.Data4[idx];
+        return result;
     };
 
-#elif defined(__linux__)
-    #include <uuid/uuid.h>
-    
+#elif defined(__linux__) || defined(__APPLE__)
     /**
      * @brief Generates a new UUID
      * 
@@ -119,268 +687,4896 @@ namespace {
      * 
      * @return UUID
     */
-    const std::string _new_uuid() {
+    inline const Uuid _new_uuid() {
         // Create a UUID object
         uuid_t uuid;
         uuid_generate(uuid);
 
-        char uuid_str[37]; // UUID string representation (36 characters + null terminator)
-        uuid_unparse(uuid, uuid_str);
-
-        return std::string(uuid_str);
+        return Uuid::from_bytes(uuid);
     }
 
 #endif
 
     /**
-     * @brief Getter for the mutex
-     * 
-     * A static local variable holds the mutex which is used in all the threadsafe methods
-    */
-    inline std::mutex* _get_mutex(){
-        static std::mutex mutex;
-        return &mutex;
-    }
-
-    /**
-     * @brief Getter for the codex (global)
-     * 
-     * A static local variable holds the mapping. Any modifications to the codex is
-     * global and therefore has to be managed in a threadsafe manner.
+     * @brief Hints the CPU to pull the cache line at `address` in, no-op where unsupported
     */
-    inline std::map<const std::string, std::unique_ptr<Thing>>* _get_mapping() {
-        // Maps the UUID to std::unique_ptr{Thing}
-        static std::map<const std::string, std::unique_ptr<Thing>> _mapping;
-        return &_mapping;
+    inline void _prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address);
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        _mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0);
+#else
+        (void)address;
+#endif
     }
 
     /**
-     * @brief Find one Thing with the given UUID
-     *
-     * This is an internal method, the public interface is get()
-     * This method is not thread safe and you could potentially run into
-     * issues if the codex is modified while this method is running on
-     * another thread.
+     * @brief Open addressing hash table keyed by Uuid
      *
-     * @tparam T The type of Thing to be retrieved
-     *
-     * @param uuid The UUID to query
-     *
-     * @return A pointer to the Thing if found, otherwise nullptr.
-    */
-    template <typename T = Thing>
-    T* _find_one_by_uuid__unsafe(const std::string& uuid) {
-        auto _mapping = _get_mapping();
-        auto it = _mapping->find(uuid);
-        return (it != _mapping->end()) ? dynamic_cast<T*>(it->second.get()) : nullptr;
-    };
-
-    /**
-     * @brief Find one Thing with the given UUID
+     * Swiss table style layout: one control byte per slot holds either kEmpty or
+     * the lower 7 bits of the key's hash (h2), the slots themselves store the key and
+     * the value inline. Lookups scan 16 control bytes at a time (SSE2 when available)
+     * and only compare keys for slots whose h2 matches, so a lookup usually touches
+     * one cache line of control bytes and one slot.
      *
-     * This is an internal method, the public interface is get()
-     * This method is threadsafe.
+     * Collisions are resolved with linear probing, which allows erase() to shift the
+     * following entries back instead of leaving tombstones behind. The table never
+     * degrades with churn and never needs a cleanup rehash.
      *
-     * @tparam T The type of Thing to be retrieved
+     * erase() moves the value out of the table and only destroys it once the table is
+     * consistent again, so a destructor running as part of erase() (eg ~Thing()
+     * removing its children) can safely re-enter the table.
      *
-     * @param uuid The UUID to query
+     * Iteration walks the slots in memory order. The order is stable as long as the
+     * table is not modified, but any insert or erase invalidates iterators.
      *
-     * @return A pointer to the Thing if found, otherwise nullptr.
+     * @tparam V The value type (eg std::unique_ptr<Thing>)
     */
-    template <typename T = Thing>
-    T* _find_one_by_uuid(const std::string& uuid) {
-        std::lock_guard<std::mutex> lock{ *_get_mutex() };
-        return _find_one_by_uuid__unsafe<T>(uuid);
-    }
-};
+    template<typename V>
+    class FlatMap {
+    public:
+        struct Slot {
+            Uuid key;
+            V value;
+        };
 
-    enum class Status {
-        SUCCESS = 0,
-        FAILURE
-    };
+    private:
+        static constexpr size_t kGroupWidth = 16;
+        static constexpr size_t kMinCapacity = 16;
+        static constexpr int8_t kEmpty = -128;
 
-    /**
-     * @brief Adds an object of type T to the Codex
-     *
-     * This function takes a unique_ptr to an instance of Thing (or a subclass) and
-     * adds it to the Codex. The Codex assumes ownership going forward
-     * This method is not thread safe and you could potentially run into
-     * issues if the codex is modified while this method is running on
-     * another thread.
-     *
-     * @tparam T The type of the object to be added. Must be a subclass of Thing
-     *
-     * @param ptr The unique ptr owning the object to be added
-     *
-     * @return A raw pointer to the object
-    */
-    template<typename T>
-    T* add__unsafe(std::unique_ptr<T> ptr) {
-        static_assert(std::is_base_of<Thing, T>::value, "T must inherit from Thing");
-        auto uuid = ptr->get_uuid();
-        (*_get_mapping())[uuid] = std::move(ptr);
-        return dynamic_cast<T*>(_get_mapping()->at(uuid).get());
-    }
+        std::unique_ptr<int8_t[]> _ctrl;    // capacity + kGroupWidth bytes, tail mirrors the head
+        std::unique_ptr<Slot[]> _slots;
+        size_t _capacity = 0;
+        size_t _size = 0;
 
-    /**
-     * @brief Adds an object of type T to the Codex
+        static size_t _h1(size_t hash) { return hash >> 7; }
+        static int8_t _h2(size_t hash) { return (int8_t)(hash & 0x7f); }
+
+        /**
+         * @brief Bitmask of the positions in the group starting at `pos` whose control byte equals `value`
+        */
+        uint32_t _match(size_t pos, int8_t value) const {
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+            const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(this->_ctrl.get() + pos));
+            return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#else
+            uint32_t mask = 0;
+            for (size_t idx = 0; idx < kGroupWidth; idx++) {
+                if (this->_ctrl[pos + idx] == value) mask |= (1u << idx);
+            }
+            return mask;
+#endif
+        }
+
+        static int _first_bit(uint32_t mask) {
+#if defined(_MSC_VER)
+            unsigned long idx;
+            _BitScanForward(&idx, mask);
+            return (int)idx;
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+
+        void _set_ctrl(size_t idx, int8_t value) {
+            this->_ctrl[idx] = value;
+            if (idx < kGroupWidth) this->_ctrl[this->_capacity + idx] = value;
+        }
+
+        size_t _find_index(const Uuid& key, size_t hash) const {
+            if (this->_capacity == 0) return SIZE_MAX;
+            const size_t mask = this->_capacity - 1;
+            const int8_t h2 = _h2(hash);
+            size_t pos = _h1(hash) & mask;
+            while (true) {
+                uint32_t matches = this->_match(pos, h2);
+                while (matches) {
+                    const size_t idx = (pos + _first_bit(matches)) & mask;
+                    if (this->_slots[idx].key == key) return idx;
+                    matches &= matches - 1;
+                }
+                if (this->_match(pos, kEmpty)) return SIZE_MAX;
+                pos = (pos + kGroupWidth) & mask;
+            }
+        }
+
+        size_t _find_empty(size_t hash) const {
+            const size_t mask = this->_capacity - 1;
+            size_t pos = _h1(hash) & mask;
+            while (true) {
+                const uint32_t empties = this->_match(pos, kEmpty);
+                if (empties) return (pos + _first_bit(empties)) & mask;
+                pos = (pos + kGroupWidth) & mask;
+            }
+        }
+
+        void _rehash(size_t capacity) {
+            std::unique_ptr<int8_t[]> old_ctrl = std::move(this->_ctrl);
+            std::unique_ptr<Slot[]> old_slots = std::move(this->_slots);
+            const size_t old_capacity = this->_capacity;
+
+            this->_capacity = capacity;
+            this->_ctrl.reset(new int8_t[capacity + kGroupWidth]);
+            std::fill(this->_ctrl.get(), this->_ctrl.get() + capacity + kGroupWidth, kEmpty);
+            this->_slots.reset(new Slot[capacity]());
+
+            for (size_t idx = 0; idx < old_capacity; idx++) {
+                if (old_ctrl[idx] == kEmpty) continue;
+                const size_t hash = old_slots[idx].key.hash();
+                const size_t target = this->_find_empty(hash);
+                this->_set_ctrl(target, _h2(hash));
+                this->_slots[target] = std::move(old_slots[idx]);
+            }
+        }
+
+        // max load factor 7/8
+        static size_t _capacity_for(size_t count) {
+            size_t capacity = kMinCapacity;
+            while (capacity - capacity / 8 < count) capacity *= 2;
+            return capacity;
+        }
+
+    public:
+        FlatMap() = default;
+        FlatMap(const FlatMap&) = delete;
+        FlatMap& operator=(const FlatMap&) = delete;
+        ~FlatMap() { this->clear(); }
+
+        /**
+         * @brief Forward iterator over the occupied slots
+        */
+        template<typename S>
+        class Iterator {
+        private:
+            const FlatMap* _map;
+            size_t _idx;
+
+            void _skip_empty() {
+                while (this->_idx < this->_map->_capacity && this->_map->_ctrl[this->_idx] == kEmpty) this->_idx++;
+            }
+
+        public:
+            Iterator(const FlatMap* map, size_t idx) : _map(map), _idx(idx) { this->_skip_empty(); }
+            S& operator*() const { return this->_map->_slots[this->_idx]; }
+            S* operator->() const { return &this->_map->_slots[this->_idx]; }
+            Iterator& operator++() { this->_idx++; this->_skip_empty(); return *this; }
+            bool operator==(const Iterator& other) const { return this->_idx == other._idx; }
+            bool operator!=(const Iterator& other) const { return this->_idx != other._idx; }
+        };
+
+        using iterator = Iterator<Slot>;
+        using const_iterator = Iterator<const Slot>;
+
+        iterator begin() { return iterator(this, 0); }
+        iterator end() { return iterator(this, this->_capacity); }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, this->_capacity); }
+
+        size_t size() const { return this->_size; }
+        size_t capacity() const { return this->_capacity; }
+        bool empty() const { return this->_size == 0; }
+
+        /**
+         * @brief Makes sure `count` entries fit without rehashing
+        */
+        void reserve(size_t count) {
+            const size_t capacity = _capacity_for(count);
+            if (capacity > this->_capacity) this->_rehash(capacity);
+        }
+
+        /**
+         * @brief Returns a pointer to the value stored for `key` or nullptr
+        */
+        V* find(const Uuid& key) {
+            const size_t idx = this->_find_index(key, key.hash());
+            return (idx != SIZE_MAX) ? &this->_slots[idx].value : nullptr;
+        }
+
+        const V* find(const Uuid& key) const {
+            const size_t idx = this->_find_index(key, key.hash());
+            return (idx != SIZE_MAX) ? &this->_slots[idx].value : nullptr;
+        }
+
+        /**
+         * @brief find() with the hash of `key` already computed, see prefetch()
+        */
+        const V* find(const Uuid& key, size_t hash) const {
+            const size_t idx = this->_find_index(key, hash);
+            return (idx != SIZE_MAX) ? &this->_slots[idx].value : nullptr;
+        }
+
+        /**
+         * @brief Pulls the control bytes and the home slot for `hash` into the cache
+        */
+        void prefetch(size_t hash) const {
+            if (this->_capacity == 0) return;
+            const size_t pos = _h1(hash) & (this->_capacity - 1);
+            _prefetch(this->_ctrl.get() + pos);
+            _prefetch(&this->_slots[pos]);
+        }
+
+        /**
+         * @brief Returns the value stored for `key`, inserting a default constructed one if missing
+         *
+         * The reference is invalidated by the next insert or erase.
+        */
+        V& operator[](const Uuid& key) {
+            return this->find_or_insert(key, key.hash());
+        }
+
+        /**
+         * @brief operator[] with the hash of `key` already computed
+        */
+        V& find_or_insert(const Uuid& key, size_t hash) {
+            size_t idx = this->_find_index(key, hash);
+            if (idx != SIZE_MAX) return this->_slots[idx].value;
+
+            if (this->_size + 1 > this->_capacity - this->_capacity / 8) {
+                this->_rehash(_capacity_for(this->_size + 1));
+            }
+            idx = this->_find_empty(hash);
+            this->_set_ctrl(idx, _h2(hash));
+            this->_slots[idx].key = key;
+            this->_size++;
+            return this->_slots[idx].value;
+        }
+
+        /**
+         * @brief Removes `key` from the table
+         *
+         * Following entries of the same probe run are shifted back into the hole, so
+         * no tombstone is left behind. The removed value is destroyed after the table
+         * is consistent again.
+         *
+         * @return true if the key was found
+        */
+        bool erase(const Uuid& key) {
+            bool found = false;
+            this->extract(key, &found);
+            return found;
+        }
+
+        /**
+         * @brief Removes `key` from the table and hands its value to the caller
+         *
+         * Same as erase(), but the caller decides when (and where) the value gets
+         * destroyed.
+         *
+         * @param found Optional, set to whether the key was in the table
+         *
+         * @return The removed value or a default constructed V if the key was missing
+        */
+        V extract(const Uuid& key, bool* found = nullptr) {
+            size_t hole = this->_find_index(key, key.hash());
+            if (found != nullptr) *found = (hole != SIZE_MAX);
+            if (hole == SIZE_MAX) return V();
+
+            V removed = std::move(this->_slots[hole].value);
+            const size_t mask = this->_capacity - 1;
+            size_t idx = hole;
+            while (true) {
+                idx = (idx + 1) & mask;
+                if (this->_ctrl[idx] == kEmpty) break;
+
+                // an entry may only move back if the hole lies between its home and itself
+                const size_t home = _h1(this->_slots[idx].key.hash()) & mask;
+                const bool stays = (hole <= idx) ? (hole < home && home <= idx) : (hole < home || home <= idx);
+                if (stays) continue;
+
+                this->_set_ctrl(hole, this->_ctrl[idx]);
+                this->_slots[hole] = std::move(this->_slots[idx]);
+                hole = idx;
+            }
+            this->_set_ctrl(hole, kEmpty);
+            this->_slots[hole].value = V();
+            this->_size--;
+            return removed;
+        }
+
+        /**
+         * @brief Removes all entries and releases the memory
+         *
+         * The table is emptied before any value is destroyed, so destructors
+         * re-entering the table simply don't find anything anymore.
+        */
+        void clear() {
+            std::unique_ptr<int8_t[]> ctrl = std::move(this->_ctrl);
+            std::unique_ptr<Slot[]> slots = std::move(this->_slots);
+            this->_capacity = 0;
+            this->_size = 0;
+        }
+    };
+
+    // C++14 still needs a definition for odr-used static constexpr members
+    template <typename V> constexpr int8_t FlatMap<V>::kEmpty;
+
+    /**
+     * @brief Set of UUIDs, a plain vector while small and a FlatMap once it grows
+     *
+     * Most Things are referenced by a handful of others, hubs by thousands. Either
+     * way inserting and erasing stay cheap.
+    */
+    class UuidSet {
+    private:
+        static constexpr size_t kSmall = 16;
+        std::vector<Uuid> _small;
+        std::unique_ptr<FlatMap<bool>> _large;
+
+    public:
+        /**
+         * @return false if `uuid` was in the set already
+        */
+        bool insert(const Uuid& uuid) {
+            if (this->_large) {
+                bool& entry = this->_large->find_or_insert(uuid, uuid.hash());
+                if (entry) return false;
+                entry = true;
+                return true;
+            }
+            if (std::find(this->_small.begin(), this->_small.end(), uuid) != this->_small.end()) return false;
+            if (this->_small.size() < kSmall) {
+                this->_small.push_back(uuid);
+                return true;
+            }
+            this->_large.reset(new FlatMap<bool>());
+            this->_large->reserve(2 * kSmall);
+            for (const auto& small : this->_small) (*this->_large)[small] = true;
+            this->_small = std::vector<Uuid>();
+            (*this->_large)[uuid] = true;
+            return true;
+        }
+
+        /**
+         * @return false if `uuid` wasn't in the set
+        */
+        bool erase(const Uuid& uuid) {
+            if (this->_large) return this->_large->erase(uuid);
+            auto it = std::find(this->_small.begin(), this->_small.end(), uuid);
+            if (it == this->_small.end()) return false;
+            *it = this->_small.back();
+            this->_small.pop_back();
+            return true;
+        }
+
+        size_t size() const { return this->_large ? this->_large->size() : this->_small.size(); }
+        bool empty() const { return this->size() == 0; }
+
+        /**
+         * @brief Calls `fn(const Uuid&)` for every UUID in the set, in no particular order
+        */
+        template <typename F>
+        void for_each(F fn) const {
+            if (this->_large) for (const auto& slot : *this->_large) fn(slot.key);
+            else for (const auto& uuid : this->_small) fn(uuid);
+        }
+    };
+
+    /**
+     * @brief One direction of a relation: the UUIDs related to each UUID, in segments of one pool
+     *
+     * Every UUID with neighbors owns a segment of the pool holding its neighbors back
+     * to back, so walking them is a sequential read. Segments double in place at the
+     * end of the pool and move to the end otherwise. Once more than half the pool
+     * is abandoned segments, it's compacted. Any modification may move segments.
+    */
+    class Adjacency {
+    private:
+        struct Segment {
+            size_t offset = 0;
+            uint32_t size = 0;
+            uint32_t capacity = 0;
+        };
+
+        FlatMap<Segment> _segments;
+        std::vector<Uuid> _pool;
+        size_t _abandoned = 0;
+
+        void _abandon(const Segment& segment) {
+            this->_abandoned += segment.capacity;
+            if (this->_abandoned < 1024 || this->_abandoned * 2 < this->_pool.size()) return;
+            std::vector<Uuid> pool;
+            pool.reserve((this->_pool.size() - this->_abandoned) * 2);
+            for (auto& slot : this->_segments) {
+                Segment& live = slot.value;
+                const size_t offset = pool.size();
+                pool.insert(pool.end(), this->_pool.begin() + live.offset, this->_pool.begin() + live.offset + live.size);
+                pool.resize(offset + live.capacity);
+                live.offset = offset;
+            }
+            this->_pool.swap(pool);
+            this->_abandoned = 0;
+        }
+
+    public:
+        /**
+         * @brief The neighbors of `uuid`, valid until the next modification
+        */
+        Span<Uuid> get(const Uuid& uuid) const {
+            const Segment* segment = this->_segments.find(uuid);
+            if (segment == nullptr) return Span<Uuid>();
+            return Span<Uuid>(this->_pool.data() + segment->offset, segment->size);
+        }
+
+        void append(const Uuid& uuid, const Uuid& neighbor) {
+            Segment& segment = this->_segments.find_or_insert(uuid, uuid.hash());
+            if (segment.size == segment.capacity) {
+                const uint32_t capacity = (segment.capacity < 4) ? 4 : segment.capacity * 2;
+                if (segment.capacity > 0 && segment.offset + segment.capacity == this->_pool.size()) {
+                    this->_pool.resize(segment.offset + capacity);
+                }
+                else {
+                    const size_t offset = this->_pool.size();
+                    this->_pool.resize(offset + capacity);
+                    std::copy(this->_pool.begin() + segment.offset, this->_pool.begin() + segment.offset + segment.size, this->_pool.begin() + offset);
+                    this->_abandoned += segment.capacity;
+                    segment.offset = offset;
+                }
+                segment.capacity = capacity;
+            }
+            this->_pool[segment.offset + segment.size++] = neighbor;
+        }
+
+        /**
+         * @brief Removes the first occurrence of `neighbor`, keeping the order of the rest
+        */
+        bool erase(const Uuid& uuid, const Uuid& neighbor) {
+            Segment* segment = this->_segments.find(uuid);
+            if (segment == nullptr) return false;
+            auto first = this->_pool.begin() + segment->offset;
+            auto last = first + segment->size;
+            auto it = std::find(first, last, neighbor);
+            if (it == last) return false;
+            std::copy(it + 1, last, it);
+            if (--segment->size > 0) return true;
+            const Segment empty = *segment;
+            this->_segments.erase(uuid);
+            this->_abandon(empty);
+            return true;
+        }
+
+        /**
+         * @brief Removes all neighbors of `uuid` and returns them
+        */
+        std::vector<Uuid> extract(const Uuid& uuid) {
+            bool found = false;
+            const Segment segment = this->_segments.extract(uuid, &found);
+            if (!found) return std::vector<Uuid>();
+            std::vector<Uuid> neighbors(this->_pool.begin() + segment.offset, this->_pool.begin() + segment.offset + segment.size);
+            this->_abandon(segment);
+            return neighbors;
+        }
+    };
+
+#ifdef DH_CODEX_LOCKFREE_READS
+    static constexpr bool kLockFreeReads = true;
+#else
+    static constexpr bool kLockFreeReads = false;
+#endif
+
+    /**
+     * @brief Epoch based memory reclamation
+     *
+     * Readers pin the current global epoch while they look at shared data. Writers
+     * unlink objects first and retire them afterwards, tagged with the epoch at the
+     * time of retirement. The global epoch only advances once every pinned reader
+     * has caught up with it, so an object retired in epoch E can't be seen by anyone
+     * once the global epoch reached E + 2 and is destroyed then.
+     *
+     * Pinning is wait free (a couple of stores to a thread local record), retiring
+     * and reclaiming take a mutex and are meant to be done by writers only.
+    */
+    class EpochDomain {
+    private:
+        // heap allocated, so padded instead of aligned (over-aligned new needs C++17)
+        struct Record {
+            std::atomic<uint64_t> epoch{ 0 };
+            std::atomic<bool> active{ false };
+            std::atomic<bool> in_use{ true };
+            Record* next = nullptr;
+            unsigned depth = 0;    // only touched by the owning thread
+            char padding[64];      // keeps records of different threads off each other's cache lines
+        };
+
+        struct Retired {
+            uint64_t epoch;
+            void* ptr;
+            void (*deleter)(void*);
+        };
+
+        // releases the calling thread's record when the thread exits
+        struct RecordHolder {
+            EpochDomain* domain = nullptr;
+            Record* record = nullptr;
+            ~RecordHolder() {
+                if (this->record == nullptr) return;
+                this->record->depth = 0;
+                this->record->active.store(false);
+                this->record->in_use.store(false);
+            }
+        };
+
+        std::atomic<uint64_t> _global{ 0 };
+        std::atomic<Record*> _records{ nullptr };    // never shrinks, records are reused
+        std::mutex _retired_mutex;
+        std::vector<Retired> _retired;
+
+        Record* _acquire_record() {
+            for (Record* record = this->_records.load(); record != nullptr; record = record->next) {
+                bool expected = false;
+                if (record->in_use.compare_exchange_strong(expected, true)) return record;
+            }
+            Record* record = new Record();
+            record->next = this->_records.load();
+            while (!this->_records.compare_exchange_weak(record->next, record)) {}
+            return record;
+        }
+
+        bool _try_advance() {
+            uint64_t epoch = this->_global.load();
+            for (Record* record = this->_records.load(); record != nullptr; record = record->next) {
+                if (record->active.load() && record->epoch.load() != epoch) return false;
+            }
+            return this->_global.compare_exchange_strong(epoch, epoch + 1);
+        }
+
+    public:
+        ~EpochDomain() {
+            // process exit, nobody is reading anymore. Deleters may retire more objects.
+            while (true) {
+                std::vector<Retired> retired;
+                {
+                    std::lock_guard<std::mutex> lock{ this->_retired_mutex };
+                    retired.swap(this->_retired);
+                }
+                if (retired.empty()) break;
+                for (const Retired& item : retired) item.deleter(item.ptr);
+            }
+
+            Record* record = this->_records.load();
+            while (record != nullptr) {
+                Record* next = record->next;
+                delete record;
+                record = next;
+            }
+        }
+
+        Record* local_record() {
+            thread_local RecordHolder holder;
+            if (holder.record == nullptr) {
+                holder.domain = this;
+                holder.record = this->_acquire_record();
+            }
+            return holder.record;
+        }
+
+        /**
+         * @brief Marks the calling thread as reading in the current epoch (nestable)
+        */
+        void pin() {
+            Record* record = this->local_record();
+            if (record->depth++ > 0) return;
+            record->epoch.store(this->_global.load());
+            record->active.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        void unpin() {
+            Record* record = this->local_record();
+            if (--record->depth > 0) return;
+            record->active.store(false, std::memory_order_release);
+        }
+
+        /**
+         * @brief Hands an already unlinked object over for deferred destruction
+        */
+        template<typename T>
+        void retire(T* ptr) {
+            this->retire(ptr, [](void* p) { delete static_cast<T*>(p); });
+        }
+
+        /**
+         * @brief retire() with a custom deleter
+        */
+        void retire(void* ptr, void (*deleter)(void*)) {
+            std::lock_guard<std::mutex> lock{ this->_retired_mutex };
+            this->_retired.push_back({ this->_global.load(), ptr, deleter });
+        }
+
+        /**
+         * @brief Tries to advance the epoch and destroys everything no reader can see anymore
+         *
+         * Deleters run without any internal lock held, so they may retire (and reclaim)
+         * further objects. Nested calls from within a deleter return immediately, the
+         * outermost call picks up their work on the next round.
+        */
+        void reclaim() {
+            thread_local bool reclaiming = false;
+            if (reclaiming) return;
+            reclaiming = true;
+
+            // keep going as long as deleters retire more objects that can be destroyed right away
+            std::vector<Retired> ready;
+            do {
+                // without readers in the way, two steps make everything retired so far safe
+                if (this->_try_advance()) this->_try_advance();
+                const uint64_t safe = this->_global.load();
+                ready.clear();
+                {
+                    std::lock_guard<std::mutex> lock{ this->_retired_mutex };
+                    auto split = std::partition(this->_retired.begin(), this->_retired.end(),
+                                                [&](const Retired& item) { return item.epoch + 2 > safe; });
+                    ready.assign(split, this->_retired.end());
+                    this->_retired.erase(split, this->_retired.end());
+                }
+                for (const Retired& item : ready) item.deleter(item.ptr);
+            } while (!ready.empty());
+
+            reclaiming = false;
+        }
+
+        /**
+         * @brief Waits until everything retired so far has been destroyed
+         *
+         * Spins until every thread that is reading right now stopped reading once,
+         * so the calling thread must not be pinned itself.
+        */
+        void synchronize() {
+            const uint64_t target = this->_global.load() + 2;
+            while (this->_global.load() < target) {
+                if (!this->_try_advance()) std::this_thread::yield();
+            }
+            this->reclaim();
+        }
+    };
+
+    /**
+     * @brief Getter for the epoch domain (global, shared by all Codices)
+    */
+    inline EpochDomain* _get_epoch_domain() {
+        static EpochDomain domain;
+        return &domain;
+    }
+
+    /**
+     * @brief RAII pin of the calling thread in the epoch domain
+    */
+    class EpochPin {
+    private:
+        bool _enabled;
+
+    public:
+        EpochPin(bool enabled = true) : _enabled(enabled) {
+            if (this->_enabled) _get_epoch_domain()->pin();
+        }
+        ~EpochPin() {
+            if (this->_enabled) _get_epoch_domain()->unpin();
+        }
+        EpochPin(const EpochPin&) = delete;
+        EpochPin& operator=(const EpochPin&) = delete;
+    };
+
+    /**
+     * @brief Concurrent UUID -> Thing* index for the lock free read path
+     *
+     * Open addressing with linear probing over atomic slots. Readers never lock and
+     * never wait, they only need to be pinned in the EpochDomain. There is only ever
+     * one writer per index (the one holding the shard lock).
+     * Keys are written once and never change: erase() only clears the pointer, and
+     * once too many of those tombstones pile up, the writer publishes a freshly built
+     * table and retires the old one through the EpochDomain.
+    */
+    class ConcurrentIndex {
+    private:
+        struct Entry {
+            std::atomic<uint64_t> hi{ 0 };
+            std::atomic<uint64_t> lo{ 0 };
+            std::atomic<Thing*> thing{ nullptr };
+        };
+
+        struct Table {
+            size_t capacity;
+            std::unique_ptr<Entry[]> entries;
+            explicit Table(size_t capacity) : capacity(capacity), entries(new Entry[capacity]) {}
+        };
+
+        std::atomic<Table*> _table{ nullptr };
+        size_t _used = 0;    // slots with a key, including tombstones
+        size_t _live = 0;
+
+        static Entry* _probe(Table* table, const Uuid& key, bool for_insert) {
+            return _probe(table, key, key.hash(), for_insert);
+        }
+
+        static Entry* _probe(Table* table, const Uuid& key, size_t hash, bool for_insert) {
+            const size_t mask = table->capacity - 1;
+            size_t idx = hash & mask;
+            for (size_t probes = 0; probes < table->capacity; probes++) {
+                Entry& entry = table->entries[idx];
+                const uint64_t hi = entry.hi.load(std::memory_order_acquire);
+                const uint64_t lo = entry.lo.load(std::memory_order_acquire);
+                if (hi == key.hi && lo == key.lo) return &entry;
+                if (hi == 0 && lo == 0) return for_insert ? &entry : nullptr;
+                idx = (idx + 1) & mask;
+            }
+            return nullptr;
+        }
+
+        void _rebuild(size_t live) {
+            size_t capacity = 16;
+            while (capacity < live * 4) capacity *= 2;
+
+            Table* table = new Table(capacity);
+            Table* old = this->_table.load(std::memory_order_relaxed);
+            size_t used = 0;
+            if (old != nullptr) {
+                for (size_t idx = 0; idx < old->capacity; idx++) {
+                    Thing* thing = old->entries[idx].thing.load(std::memory_order_relaxed);
+                    if (thing == nullptr) continue;
+                    Uuid key;
+                    key.hi = old->entries[idx].hi.load(std::memory_order_relaxed);
+                    key.lo = old->entries[idx].lo.load(std::memory_order_relaxed);
+                    Entry* entry = _probe(table, key, true);
+                    entry->lo.store(key.lo, std::memory_order_relaxed);
+                    entry->hi.store(key.hi, std::memory_order_relaxed);
+                    entry->thing.store(thing, std::memory_order_relaxed);
+                    used++;
+                }
+            }
+            this->_used = used;
+            this->_table.store(table, std::memory_order_release);
+            if (old != nullptr) _get_epoch_domain()->retire(old);
+        }
+
+    public:
+        ConcurrentIndex() = default;
+        ConcurrentIndex(const ConcurrentIndex&) = delete;
+        ConcurrentIndex& operator=(const ConcurrentIndex&) = delete;
+        ~ConcurrentIndex() { delete this->_table.load(); }
+
+        /**
+         * @brief Lookup, the calling thread has to be pinned
+        */
+        Thing* find(const Uuid& key) const {
+            return this->find(key, key.hash());
+        }
+
+        /**
+         * @brief find() with the hash of `key` already computed, see prefetch()
+        */
+        Thing* find(const Uuid& key, size_t hash) const {
+            Table* table = this->_table.load(std::memory_order_acquire);
+            if (table == nullptr || key.is_nil()) return nullptr;
+            Entry* entry = _probe(table, key, hash, false);
+            return (entry != nullptr) ? entry->thing.load(std::memory_order_acquire) : nullptr;
+        }
+
+        /**
+         * @brief Pulls the home entry for `hash` into the cache, the calling thread has to be pinned
+        */
+        void prefetch(size_t hash) const {
+            Table* table = this->_table.load(std::memory_order_acquire);
+            if (table != nullptr) _prefetch(&table->entries[hash & (table->capacity - 1)]);
+        }
+
+        /**
+         * @brief Makes room for `count` more keys without rebuilding in between, writer only
+        */
+        void reserve(size_t count) {
+            Table* table = this->_table.load(std::memory_order_relaxed);
+            if (table == nullptr || (this->_used + count) * 2 > table->capacity) this->_rebuild(this->_live + count);
+        }
+
+        /**
+         * @brief Publishes `thing` under `key`, writer only
+        */
+        void insert(const Uuid& key, Thing* thing) {
+            Table* table = this->_table.load(std::memory_order_relaxed);
+            if (table == nullptr || (this->_used + 1) * 2 > table->capacity) {
+                this->_rebuild(this->_live + 1);
+                table = this->_table.load(std::memory_order_relaxed);
+            }
+            Entry* entry = _probe(table, key, true);
+            if (entry->hi.load(std::memory_order_relaxed) == 0 && entry->lo.load(std::memory_order_relaxed) == 0) {
+                entry->lo.store(key.lo, std::memory_order_release);
+                entry->hi.store(key.hi, std::memory_order_release);
+                this->_used++;
+            }
+            if (entry->thing.exchange(thing, std::memory_order_acq_rel) == nullptr) this->_live++;
+        }
+
+        /**
+         * @brief Hides `key` from readers, writer only
+        */
+        void erase(const Uuid& key) {
+            Table* table = this->_table.load(std::memory_order_relaxed);
+            if (table == nullptr) return;
+            Entry* entry = _probe(table, key, false);
+            if (entry != nullptr && entry->thing.exchange(nullptr, std::memory_order_acq_rel) != nullptr) this->_live--;
+        }
+    };
+
+#ifdef DH_CODEX_SHARED_MUTEX
+    static constexpr bool kSharedMutex = true;
+#else
+    static constexpr bool kSharedMutex = false;
+#endif
+
+#ifdef DH_CODEX_SINGLE_THREADED
+    static constexpr bool kSingleThreaded = true;
+#else
+    static constexpr bool kSingleThreaded = false;
+#endif
+#if defined(DH_CODEX_SINGLE_THREADED) && \
+    (defined(DH_CODEX_SHARED_MUTEX) || defined(DH_CODEX_LOCKFREE_READS) || defined(DH_CODEX_BACKGROUND_RECLAIM))
+#error "DH_CODEX_SINGLE_THREADED can't be combined with DH_CODEX_SHARED_MUTEX, DH_CODEX_LOCKFREE_READS or DH_CODEX_BACKGROUND_RECLAIM"
+#endif
+
+    /**
+     * @brief Writer preferring reader/writer lock with a handoff to waiting readers
+     *
+     * Readers only touch a single atomic on the fast path. As soon as a writer
+     * announces itself, new readers queue up behind it, so a steady stream of
+     * readers can't starve writers. Writers are serialized among each other by a
+     * regular mutex and then wait for the remaining readers to drain.
+     * In turn, unlock() admits every reader that queued up behind the writer before
+     * the next writer can announce itself, so back to back writers can't starve
+     * readers either: each write is followed by at most one batch of reads.
+     * std::shared_mutex isn't used since its fairness is implementation defined
+     * (and glibc's default prefers readers).
+    */
+    class SharedMutex {
+    private:
+        static constexpr uint32_t kWriter = 1u << 31;
+
+        std::atomic<uint32_t> _state{ 0 };    // kWriter | number of readers
+        std::mutex _writer_mutex;
+        std::mutex _wait_mutex;
+        std::condition_variable _readers_cv;
+        std::condition_variable _writer_cv;
+        uint32_t _waiting = 0;                // readers queued behind the writer, guarded by _wait_mutex
+        uint64_t _phase = 0;                  // bumped by every unlock(), guarded by _wait_mutex
+
+    public:
+        void lock_shared() {
+            while (true) {
+                uint32_t state = this->_state.load(std::memory_order_relaxed);
+                if (!(state & kWriter)) {
+                    if (this->_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire)) return;
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock{ this->_wait_mutex };
+                // the writer may have left before we got the lock
+                if (!(this->_state.load(std::memory_order_relaxed) & kWriter)) continue;
+                const uint64_t phase = this->_phase;
+                this->_waiting++;
+                this->_readers_cv.wait(lock, [this, phase] { return this->_phase != phase; });
+                // unlock() already counted us as a reader
+                return;
+            }
+        }
+
+        void unlock_shared() {
+            const uint32_t previous = this->_state.fetch_sub(1, std::memory_order_release);
+            if (previous == (kWriter | 1)) {
+                // last reader out while a writer is waiting
+                std::lock_guard<std::mutex> lock{ this->_wait_mutex };
+                this->_writer_cv.notify_one();
+            }
+        }
+
+        void lock() {
+            this->_writer_mutex.lock();
+            this->_state.fetch_or(kWriter, std::memory_order_acquire);
+            if (this->_state.load(std::memory_order_acquire) == kWriter) return;
+            std::unique_lock<std::mutex> lock{ this->_wait_mutex };
+            this->_writer_cv.wait(lock, [this] { return this->_state.load(std::memory_order_acquire) == kWriter; });
+        }
+
+        void unlock() {
+            {
+                std::lock_guard<std::mutex> lock{ this->_wait_mutex };
+                // no reader can hold the lock right now, so the queued ones become the readers
+                this->_state.store(this->_waiting, std::memory_order_release);
+                this->_waiting = 0;
+                this->_phase++;
+                this->_readers_cv.notify_all();
+            }
+            this->_writer_mutex.unlock();
+        }
+    };
+
+    enum class Access {
+        EXCLUSIVE = 0,
+        SHARED
+    };
+
+    /**
+     * @brief Takes the place of the Codex's mutexes with DH_CODEX_SINGLE_THREADED
+     *
+     * Every call is empty, so locking compiles down to nothing.
+    */
+    struct NullMutex {
+        void lock() {}
+        void unlock() {}
+        void lock_shared() {}
+        void unlock_shared() {}
+    };
+
+    // guards the Codex's own state (roots, relations, the GC barrier)
+    using Mutex = std::conditional<kSingleThreaded, NullMutex, std::mutex>::type;
+    using RelationMutex = std::conditional<kSingleThreaded, NullMutex, SharedMutex>::type;
+    using ShardMutex = std::conditional<kSingleThreaded, NullMutex,
+                                        std::conditional<kSharedMutex, SharedMutex, std::mutex>::type>::type;
+
+    inline void _lock(NullMutex&, Access) {}
+    inline void _unlock(NullMutex&, Access) {}
+    inline void _lock(std::mutex& mutex, Access) { mutex.lock(); }
+    inline void _unlock(std::mutex& mutex, Access) { mutex.unlock(); }
+    inline void _lock(SharedMutex& mutex, Access access) {
+        (access == Access::SHARED) ? mutex.lock_shared() : mutex.lock();
+    }
+    inline void _unlock(SharedMutex& mutex, Access access) {
+        (access == Access::SHARED) ? mutex.unlock_shared() : mutex.unlock();
+    }
+
+    /**
+     * @brief Dense slot array backing Handle<T>
+     *
+     * Every Thing in a shard occupies one slot, freed slots are reused through a free
+     * list. Removing a Thing bumps its slot's generation, which is what invalidates
+     * outstanding Handles.
+     * Entries are atomics and the array grows by publishing a copy, so readers can
+     * resolve Handles without a lock when DH_CODEX_LOCKFREE_READS is used (the old
+     * copy is retired through the EpochDomain). Only the shard lock holder may
+     * acquire or release slots.
+    */
+    class SlotArray {
+    private:
+        struct Entry {
+            std::atomic<Thing*> thing{ nullptr };
+            std::atomic<uint32_t> generation{ 1 };
+            uint32_t next_free = UINT32_MAX;
+        };
+
+        struct Table {
+            size_t capacity;
+            std::unique_ptr<Entry[]> entries;
+            explicit Table(size_t capacity) : capacity(capacity), entries(new Entry[capacity]) {}
+        };
+
+        std::atomic<Table*> _table{ nullptr };
+        uint32_t _used = 0;    // high water mark
+        uint32_t _free = UINT32_MAX;
+
+        void _grow() {
+            Table* old = this->_table.load(std::memory_order_relaxed);
+            Table* table = new Table((old != nullptr) ? old->capacity * 2 : 64);
+            for (size_t idx = 0; old != nullptr && idx < old->capacity; idx++) {
+                table->entries[idx].thing.store(old->entries[idx].thing.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                table->entries[idx].generation.store(old->entries[idx].generation.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                table->entries[idx].next_free = old->entries[idx].next_free;
+            }
+            this->_table.store(table, std::memory_order_release);
+            if (old == nullptr) return;
+            if (kLockFreeReads) _get_epoch_domain()->retire(old);
+            else delete old;
+        }
+
+    public:
+        SlotArray() = default;
+        SlotArray(const SlotArray&) = delete;
+        SlotArray& operator=(const SlotArray&) = delete;
+        ~SlotArray() { delete this->_table.load(); }
+
+        /**
+         * @brief Hands out a slot for `thing`, writer only
+         *
+         * @param generation Set to the generation of the slot
+         *
+         * @return The slot's index
+        */
+        uint32_t acquire(Thing* thing, uint32_t* generation) {
+            uint32_t idx = this->_free;
+            if (idx != UINT32_MAX) {
+                this->_free = this->_table.load(std::memory_order_relaxed)->entries[idx].next_free;
+            }
+            else {
+                Table* table = this->_table.load(std::memory_order_relaxed);
+                if (table == nullptr || this->_used == table->capacity) this->_grow();
+                idx = this->_used++;
+            }
+            Entry& entry = this->_table.load(std::memory_order_relaxed)->entries[idx];
+            *generation = entry.generation.load(std::memory_order_relaxed);
+            entry.thing.store(thing, std::memory_order_release);
+            return idx;
+        }
+
+        /**
+         * @brief Frees a slot and invalidates all Handles to it, writer only
+        */
+        void release(uint32_t idx) {
+            Entry& entry = this->_table.load(std::memory_order_relaxed)->entries[idx];
+            entry.thing.store(nullptr, std::memory_order_release);
+            uint32_t generation = entry.generation.load(std::memory_order_relaxed) + 1;
+            entry.generation.store((generation == 0) ? 1 : generation, std::memory_order_release);
+            entry.next_free = this->_free;
+            this->_free = idx;
+        }
+
+        /**
+         * @brief Number of slots handed out so far, including freed ones, shard lock holder only
+        */
+        uint32_t used() const { return this->_used; }
+
+        /**
+         * @brief The Thing in slot `idx` no matter its generation, nullptr if free, shard lock holder only
+        */
+        Thing* at(uint32_t idx) const {
+            if (idx >= this->_used) return nullptr;
+            return this->_table.load(std::memory_order_relaxed)->entries[idx].thing.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief The Thing in slot `idx` if its generation still matches, otherwise nullptr
+         *
+         * The caller either holds the shard lock or is pinned in the EpochDomain.
+        */
+        Thing* resolve(uint32_t idx, uint32_t generation) const {
+            const Table* table = this->_table.load(std::memory_order_acquire);
+            if (table == nullptr || idx >= table->capacity) return nullptr;
+            const Entry& entry = table->entries[idx];
+            if (entry.generation.load(std::memory_order_acquire) != generation) return nullptr;
+            Thing* thing = entry.thing.load(std::memory_order_acquire);
+            // the slot might have been released and reused in between
+            return (entry.generation.load(std::memory_order_acquire) == generation) ? thing : nullptr;
+        }
+    };
+
+    /**
+     * @brief Where the memory of a Thing came from, see ThingDeleter
+     *
+     * One per SlabPool, so telling a pooled Thing from a heap allocated one doesn't
+     * depend on anything stored in the Thing (a copy of a pooled Thing lives on the heap).
+    */
+    struct ThingStorage {
+        // destroys the Thing and returns its memory
+        void (*release)(Thing*);
+        // the same for the EpochDomain, runs it as deferred destruction (see _destroy())
+        void (*retire)(void*);
+    };
+
+    /**
+     * @brief Deleter for the Things owned by the Codex
+     *
+     * Things created through emplace() live in a SlabPool and go back to it,
+     * everything else gets deleted. Defined after Thing.
+    */
+    struct ThingDeleter {
+        // nullptr for Things allocated with `new`
+        const ThingStorage* storage = nullptr;
+
+        ThingDeleter() = default;
+        explicit ThingDeleter(const ThingStorage* storage) : storage(storage) {}
+        // lets add() take ownership of plain std::unique_ptr<T>
+        template<typename U>
+        ThingDeleter(const std::default_delete<U>&) {}
+
+        inline void operator()(Thing* thing) const;
+    };
+
+    using ThingPtr = std::unique_ptr<Thing, ThingDeleter>;
+
+    /**
+     * @brief EpochDomain deleter for Things living in `Pool`, defined after _destroy()
+    */
+    template<typename Pool>
+    void _destroy_retired(void* thing);
+
+    /**
+     * @brief Typed storage for Things created through emplace()
+     *
+     * Objects of one type are carved out of fixed size slabs (kSlabBytes, at least
+     * kMinSlabCells cells), so Things of the same type share pages instead of being
+     * spread over the heap. Freed cells go onto a free list and are reused by the
+     * next allocation.
+     * Every thread keeps a small cache of free cells per pool and only exchanges
+     * them with the shared free list in batches of kBatch, so creating and removing
+     * short lived Things usually doesn't touch the pool's mutex at all.
+     * There is one pool per type, it is never destroyed since Things may still be
+     * returned to it while the Codex itself is torn down at exit.
+     *
+     * @tparam T The concrete type stored
+    */
+    template<typename T>
+    class SlabPool {
+    private:
+        union Cell {
+            Cell* next;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        };
+
+        static constexpr size_t kSlabBytes = 64 * 1024;
+        static constexpr size_t kMinSlabCells = 16;
+        static constexpr size_t kSlabCells = (kSlabBytes / sizeof(Cell) > kMinSlabCells) ? kSlabBytes / sizeof(Cell) : kMinSlabCells;
+        static constexpr size_t kBatch = 32;
+
+        struct ThreadCache {
+            Cell* head = nullptr;
+            size_t count = 0;
+
+            ~ThreadCache() {
+                _thread_exited() = true;
+                if (this->head != nullptr) instance()._give(this->head, this->count);
+            }
+        };
+
+        std::mutex _mutex;
+        std::vector<std::unique_ptr<Cell[]>> _slabs;
+        Cell* _free = nullptr;
+
+        SlabPool() = default;
+
+        // trivially destructible, so it can still be read while thread locals are torn down
+        static bool& _thread_exited() {
+            thread_local bool exited = false;
+            return exited;
+        }
+
+        // nullptr once the calling thread is exiting, Things destroyed after that go straight to the pool
+        static ThreadCache* _thread_cache() {
+            if (_thread_exited()) return nullptr;
+            thread_local ThreadCache cache;
+            return &cache;
+        }
+
+        /**
+         * @brief Pops up to `count` cells off the shared free list, allocating a slab if it's empty
+        */
+        Cell* _take(size_t count, size_t* taken) {
+            std::lock_guard<std::mutex> lock{ this->_mutex };
+            if (this->_free == nullptr) {
+                std::unique_ptr<Cell[]> slab(new Cell[kSlabCells]);
+                for (size_t idx = kSlabCells; idx-- > 0;) {
+                    slab[idx].next = this->_free;
+                    this->_free = &slab[idx];
+                }
+                this->_slabs.push_back(std::move(slab));
+            }
+            Cell* head = this->_free;
+            Cell* tail = head;
+            *taken = 1;
+            while (*taken < count && tail->next != nullptr) {
+                tail = tail->next;
+                (*taken)++;
+            }
+            this->_free = tail->next;
+            tail->next = nullptr;
+            return head;
+        }
+
+        /**
+         * @brief Pushes a list of `count` cells onto the shared free list
+        */
+        void _give(Cell* head, size_t count) {
+            Cell* tail = head;
+            for (size_t idx = 1; idx < count; idx++) tail = tail->next;
+            std::lock_guard<std::mutex> lock{ this->_mutex };
+            tail->next = this->_free;
+            this->_free = head;
+        }
+
+    public:
+        SlabPool(const SlabPool&) = delete;
+        SlabPool& operator=(const SlabPool&) = delete;
+
+        static SlabPool& instance() {
+            static SlabPool* pool = new SlabPool();
+            return *pool;
+        }
+
+        /**
+         * @brief The ThingStorage handed to ThingDeleter for the Things in this pool
+        */
+        static const ThingStorage* storage() {
+            static const ThingStorage storage{ &SlabPool::release, &_destroy_retired<SlabPool> };
+            return &storage;
+        }
+
+        /**
+         * @brief Uninitialized memory for one T
+        */
+        void* allocate() {
+            ThreadCache* cache = _thread_cache();
+            size_t taken;
+            if (cache == nullptr) return this->_take(1, &taken);
+            if (cache->head == nullptr) cache->head = this->_take(kBatch, &cache->count);
+            Cell* cell = cache->head;
+            cache->head = cell->next;
+            cache->count--;
+            return cell;
+        }
+
+        /**
+         * @brief Number of slabs allocated so far, a pool never gives them back
+        */
+        size_t slabs() {
+            std::lock_guard<std::mutex> lock{ this->_mutex };
+            return this->_slabs.size();
+        }
+
+        /**
+         * @brief Returns memory obtained from allocate(), the object has to be destroyed already
+        */
+        void deallocate(void* memory) {
+            Cell* cell = static_cast<Cell*>(memory);
+            ThreadCache* cache = _thread_cache();
+            if (cache == nullptr) return this->_give(cell, 1);
+            cell->next = cache->head;
+            cache->head = cell;
+            if (++cache->count <= 2 * kBatch) return;
+            // hand the older half back, keeping the recently freed (and cached) cells
+            Cell* keep = cache->head;
+            for (size_t idx = 1; idx < kBatch; idx++) keep = keep->next;
+            this->_give(keep->next, cache->count - kBatch);
+            keep->next = nullptr;
+            cache->count = kBatch;
+        }
+
+        /**
+         * @brief Destroys a T created in this pool and returns its memory, see ThingStorage
+        */
+        static void release(Thing* thing) {
+            T* object = static_cast<T*>(thing);
+            object->~T();
+            instance().deallocate(object);
+        }
+    };
+
+    static constexpr size_t kShardCount = DH_CODEX_SHARDS;
+    static constexpr bool kSharded = kShardCount > 1;
+    static_assert(kShardCount >= 1 && kShardCount <= 64 && (kShardCount & (kShardCount - 1)) == 0,
+                  "DH_CODEX_SHARDS must be a power of two between 1 and 64");
+
+    /**
+     * @brief One independently locked part of the Codex
+     *
+     * Aligned to a cache line so threads working on different shards don't
+     * invalidate each other's mutex.
+    */
+    struct alignas(64) Shard {
+        ShardMutex mutex;
+        // Maps the UUID to std::unique_ptr{Thing}
+        FlatMap<ThingPtr> mapping;
+        // Mirror of mapping for the lock free read path (DH_CODEX_LOCKFREE_READS)
+        ConcurrentIndex index;
+        // Slots for Handle<T>
+        SlotArray slots;
+        // Things linking to the Things of this shard and the other way around, see link()
+        FlatMap<UuidSet> referrers;
+        FlatMap<UuidSet> referents;
+        // Bumped whenever a Thing leaves the shard, see Ref. Read on every Ref
+        // dereference, so it gets its own cache line instead of sharing the mutex's
+        alignas(64) std::atomic<uint64_t> removals{ 0 };
+    };
+
+    // Everything a Codex owns, defined once all of its parts are, see Codex
+    struct CodexData;
+
+    /**
+     * @brief A Codex the calling thread is working with, see CodexScope
+    */
+    struct CodexContext {
+        CodexData* codex;
+        // the shards of `codex` locked by the thread, shared between the contexts of one Codex
+        uint64_t* held;
+        uint64_t own_held;
+        CodexContext* outer;
+    };
+
+    inline CodexContext*& _current_context() {
+        thread_local CodexContext* context = nullptr;
+        return context;
+    }
+
+    inline CodexData* _default_codex_data();
+
+    /**
+     * @brief The Codex the free functions work on, the default one unless a CodexScope says otherwise
+    */
+    inline CodexData* _codex() {
+        const CodexContext* context = _current_context();
+        return (context != nullptr) ? context->codex : _default_codex_data();
+    }
+
+    /**
+     * @brief Getter for the shards of the current Codex
+     *
+     * Defined after CodexData.
+    */
+    inline Shard* _get_shards();
+
+    /**
+     * @brief Picks the shard for a UUID
+     *
+     * Uses the top bits of the hash, the lower ones are used by the FlatMap to find
+     * the slot within the shard.
+    */
+    inline size_t _shard_index_for_hash(size_t hash) {
+        return kSharded ? (size_t)((uint64_t)hash >> 58) & (kShardCount - 1) : 0;
+    }
+
+    inline size_t _shard_index(const Uuid& uuid) {
+        return _shard_index_for_hash(uuid.hash());
+    }
+
+    constexpr uint32_t _log2(size_t value) { return (value <= 1) ? 0 : 1 + _log2(value / 2); }
+    static constexpr uint32_t kShardBits = _log2(kShardCount);
+
+    /**
+     * @brief Handle indices carry their shard in the lowest bits
+    */
+    inline uint32_t _handle_index(size_t shard, uint32_t slot) { return (slot << kShardBits) | (uint32_t)shard; }
+    inline size_t _handle_shard(uint32_t index) { return index & (kShardCount - 1); }
+    inline uint32_t _handle_slot(uint32_t index) { return index >> kShardBits; }
+
+    inline uint64_t& _default_held_shards() {
+        thread_local uint64_t held = 0;
+        return held;
+    }
+
+    /**
+     * @brief Bitmask of the shards of the current Codex locked by the calling thread
+    */
+    inline uint64_t& _held_shards() {
+        CodexContext* context = _current_context();
+        return (context != nullptr) ? *context->held : _default_held_shards();
+    }
+
+    /**
+     * @brief Whether the calling thread holds a shard of any Codex
+    */
+    inline bool _any_shards_held() {
+        if (_default_held_shards() != 0) return true;
+        for (const CodexContext* context = _current_context(); context != nullptr; context = context->outer) {
+            if (*context->held != 0) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief RAII switch of the calling thread's current Codex
+     *
+     * Does nothing if `codex` already is the current one (or nullptr). Contexts of
+     * the same Codex share their held shards, so switching back into a Codex
+     * doesn't lock what the thread already holds further out.
+    */
+    class CodexScope {
+    private:
+        CodexContext _context;
+        bool _active = false;
+
+    public:
+        explicit CodexScope(CodexData* codex) {
+            if (codex == nullptr || codex == _codex()) return;
+            CodexContext* current = _current_context();
+            this->_context = { codex, &this->_context.own_held, 0, current };
+            if (codex == _default_codex_data()) this->_context.held = &_default_held_shards();
+            for (CodexContext* context = current; context != nullptr; context = context->outer) {
+                if (context->codex != codex) continue;
+                this->_context.held = context->held;
+                break;
+            }
+            _current_context() = &this->_context;
+            this->_active = true;
+        }
+
+        ~CodexScope() {
+            if (this->_active) _current_context() = this->_context.outer;
+        }
+
+        CodexScope(const CodexScope&) = delete;
+        CodexScope& operator=(const CodexScope&) = delete;
+    };
+
+    /**
+     * @brief Getters for the current Codex, defined after CodexData
+    */
+    inline CodexState* _codex_state();
+    inline uint64_t _codex_serial();
+    inline CodexData* _codex_data(CodexState* state);
+
+    /**
+     * @brief Greater than 0 while the calling thread runs the destructors of removed Things
+    */
+    inline int& _destruction_depth() {
+        thread_local int depth = 0;
+        return depth;
+    }
+
+    /**
+     * @brief Whether the __unsafe functions have to lock for themselves
+     *
+     * Always in sharded mode. Otherwise only while the calling thread runs deferred
+     * destructors, since those run without any lock held (see _dispose()).
+    */
+    inline bool _self_locking() {
+        return kSharded || _destruction_depth() > 0;
+    }
+
+    /**
+     * @brief RAII lock for a single shard
+     *
+     * Does nothing if the calling thread already holds the shard (eg get() called from
+     * within a destructor that runs under remove()), so the lock can't deadlock on itself.
+     * Access::SHARED only makes a difference with DH_CODEX_SHARED_MUTEX.
+    */
+    class ShardLock {
+    private:
+        size_t _shard;
+        Access _access;
+        bool _owns = false;
+
+    public:
+        ShardLock(size_t shard, bool enabled = true, Access access = Access::EXCLUSIVE) : _shard(shard), _access(access) {
+            const uint64_t bit = 1ull << shard;
+            if (!enabled || (_held_shards() & bit)) return;
+            _lock(_get_shards()[shard].mutex, access);
+            _held_shards() |= bit;
+            this->_owns = true;
+        }
+
+        ~ShardLock() {
+            if (!this->_owns) return;
+            _held_shards() &= ~(1ull << this->_shard);
+            _unlock(_get_shards()[this->_shard].mutex, this->_access);
+        }
+
+        ShardLock(const ShardLock&) = delete;
+        ShardLock& operator=(const ShardLock&) = delete;
+    };
+
+    /**
+     * @brief RAII lock for all shards, or a subset of them
+     *
+     * Shards are always locked in ascending order, which together with single shard
+     * operations never acquiring a second shard makes the locking deadlock free.
+     * Shards already held by the calling thread are skipped.
+    */
+    class AllShardsLock {
+    private:
+        Access _access;
+        uint64_t _owned = 0;
+
+    public:
+        AllShardsLock(bool enabled = true, Access access = Access::EXCLUSIVE)
+            : AllShardsLock(~0ull, enabled, access) {}
+
+        /**
+         * @brief Only locks the shards whose bit is set in `shards`
+        */
+        AllShardsLock(uint64_t shards, bool enabled, Access access) : _access(access) {
+            if (!enabled) return;
+            for (size_t shard = 0; shard < kShardCount; shard++) {
+                const uint64_t bit = 1ull << shard;
+                if (!(shards & bit) || (_held_shards() & bit)) continue;
+                _lock(_get_shards()[shard].mutex, access);
+                _held_shards() |= bit;
+                this->_owned |= bit;
+            }
+        }
+
+        ~AllShardsLock() {
+            for (size_t shard = kShardCount; shard-- > 0;) {
+                const uint64_t bit = 1ull << shard;
+                if (!(this->_owned & bit)) continue;
+                _held_shards() &= ~bit;
+                _unlock(_get_shards()[shard].mutex, this->_access);
+            }
+        }
+
+        AllShardsLock(const AllShardsLock&) = delete;
+        AllShardsLock& operator=(const AllShardsLock&) = delete;
+    };
+
+    /**
+     * @brief `thing`, or nullptr while a remove_cascade_incremental() is pending for it
+     *
+     * Defined after Thing.
+    */
+    inline Thing* _visible(Thing* thing);
+
+    /**
+     * @brief Find one Thing with the given UUID
+     *
+     * This is an internal method, the public interface is get()
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     *
+     * @tparam T The type of Thing to be retrieved
+     *
+     * @param uuid The UUID to query
+     *
+     * @return A pointer to the Thing if found, otherwise nullptr.
+    */
+    template <typename T = Thing>
+    T* _find_one_by_uuid__unsafe(const Uuid& uuid) {
+        Shard& shard = _get_shards()[_shard_index(uuid)];
+        if (kLockFreeReads) {
+            // the caller is pinned, so whatever we find can't be destroyed under us
+            Thing* thing = shard.index.find(uuid);
+            return thing_cast<T>(_visible(thing));
+        }
+        auto entry = shard.mapping.find(uuid);
+        return (entry != nullptr) ? thing_cast<T>(_visible(entry->get())) : nullptr;
+    };
+
+    /**
+     * @brief Find one Thing with the given UUID
+     *
+     * This is an internal method, the public interface is get()
+     * This method is threadsafe.
+     *
+     * @tparam T The type of Thing to be retrieved
+     *
+     * @param uuid The UUID to query
+     *
+     * @return A pointer to the Thing if found, otherwise nullptr.
+    */
+    template <typename T = Thing>
+    T* _find_one_by_uuid(const Uuid& uuid) {
+        ShardLock lock{ _shard_index(uuid), !kLockFreeReads, Access::SHARED };
+        EpochPin pin{ kLockFreeReads };
+        return _find_one_by_uuid__unsafe<T>(uuid);
+    }
+
+    /**
+     * @brief Find many Things at once
+     *
+     * This is an internal method, the public interface is get_many(). Doesn't lock
+     * or pin, the caller does.
+     *
+     * @tparam T The type of Thing to be retrieved
+     *
+     * @param uuids The UUIDs to query
+     * @param count Number of UUIDs
+     * @param out Receives `count` pointers
+    */
+    template <typename T = Thing>
+    void _find_many_by_uuid__unsafe(const Uuid* uuids, size_t count, T** out) {
+        Shard* shards = _get_shards();
+        constexpr size_t kBatch = 16;
+        size_t hashes[kBatch];
+        for (size_t begin = 0; begin < count; begin += kBatch) {
+            const size_t batch = std::min(kBatch, count - begin);
+            for (size_t idx = 0; idx < batch; idx++) {
+                hashes[idx] = uuids[begin + idx].hash();
+                Shard& shard = shards[_shard_index_for_hash(hashes[idx])];
+                if (kLockFreeReads) shard.index.prefetch(hashes[idx]);
+                else shard.mapping.prefetch(hashes[idx]);
+            }
+            for (size_t idx = 0; idx < batch; idx++) {
+                const Uuid& uuid = uuids[begin + idx];
+                const Shard& shard = shards[_shard_index_for_hash(hashes[idx])];
+                Thing* thing;
+                if (kLockFreeReads) {
+                    thing = shard.index.find(uuid, hashes[idx]);
+                }
+                else {
+                    const ThingPtr* entry = shard.mapping.find(uuid, hashes[idx]);
+                    thing = (entry != nullptr) ? entry->get() : nullptr;
+                }
+                out[begin + idx] = thing_cast<T>(_visible(thing));
+            }
+        }
+    }
+
+    /**
+     * @brief Hands a Thing that has been unlinked from the Codex over for destruction
+     *
+     * The Thing goes onto the calling thread's retire list, its removal hooks run
+     * and it's destroyed as soon as the thread doesn't hold any shard anymore,
+     * so neither hooks nor destructors run under a lock. With DH_CODEX_LOCKFREE_READS, the Thing is retired in the
+     * epoch domain instead and destroyed once no reader can see it anymore. With
+     * DH_CODEX_BACKGROUND_RECLAIM, the destructors run on a background thread.
+     * Defined after Thing.
+    */
+    inline void _dispose(ThingPtr thing);
+
+    /**
+     * @brief Same as _dispose(), but leaves the reclaiming to the caller
+     *
+     * Use this for batches followed by a single _reclaim_deferred(), so the removal
+     * hooks see the whole batch at once. Defined after Thing.
+    */
+    inline void _retire(ThingPtr thing);
+
+    /**
+     * @brief Destroys what the calling thread retired, if it doesn't hold any shard
+     *
+     * Defined after Thing.
+    */
+    inline void _reclaim_deferred();
+
+    /**
+     * @brief Gives `thing` a slot in its shard's SlotArray, shard lock holder only
+     *
+     * Defined after Thing.
+    */
+    inline void _assign_slot(size_t shard, Thing* thing);
+
+    /**
+     * @brief Frees the slot of `thing`, invalidating all Handles to it, shard lock holder only
+     *
+     * Defined after Thing.
+    */
+    inline void _release_slot(size_t shard, Thing* thing);
+};
+
+    // the rest of the header uses the internals unqualified
+    using namespace detail;
+
+    inline Uuid Uuid::generate() {
+        return _new_uuid();
+    }
+
+    inline Uuid Uuid::generate_v7() {
+        return _get_uuid_generator().v7();
+    }
+
+    enum class Status {
+        SUCCESS = 0,
+        FAILURE
+    };
+
+namespace detail {
+    /**
+     * @brief add__unsafe() for any deleter ThingPtr can take over, see emplace()
+     *
+     * @param replaced_out If not nullptr, receives the Thing replaced by `ptr` (if
+     *        any) instead of it being destroyed, see Session
+    */
+    template<typename T, typename D>
+    T* _add__unsafe(std::unique_ptr<T, D> ptr, ThingPtr* replaced_out = nullptr) {
+        const Uuid uuid = ptr->get_id();
+        const size_t shard = _shard_index(uuid);
+        // an existing entry with the same UUID gets replaced, but only destroyed
+        // once the new one is in place (and in sharded mode, the lock is released)
+        ThingPtr replaced;
+        T* result = ptr.get();
+        {
+            ShardLock lock{ shard, _self_locking() };
+            ThingPtr& entry = _get_shards()[shard].mapping[uuid];
+            replaced = std::move(entry);
+            entry = std::move(ptr);
+            if (replaced) _release_slot(shard, replaced.get());
+            _assign_slot(shard, entry.get());
+            if (kLockFreeReads) _get_shards()[shard].index.insert(uuid, entry.get());
+            // counts as a removal once the replaced Thing can't be found anymore, see Ref
+            if (replaced) _get_shards()[shard].removals.fetch_add(1, std::memory_order_release);
+        }
+        if (replaced_out != nullptr) *replaced_out = std::move(replaced);
+        else if (replaced) _dispose(std::move(replaced));
+        return result;
+    }
+};
+
+    /**
+     * @brief Adds an object of type T to the Codex
+     *
+     * This function takes a unique_ptr to an instance of Thing (or a subclass) and
+     * adds it to the Codex. The Codex assumes ownership going forward
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) the shard of the UUID gets locked
+     * unless the calling thread already holds it.
+     *
+     * @tparam T The type of the object to be added. Must be a subclass of Thing
+     *
+     * @param ptr The unique ptr owning the object to be added
+     *
+     * @return A raw pointer to the object
+    */
+    template<typename T>
+    T* add__unsafe(std::unique_ptr<T> ptr) {
+        static_assert(std::is_base_of<Thing, T>::value, "T must inherit from Thing");
+        return _add__unsafe<T>(std::move(ptr));
+    }
+
+    /**
+     * @brief Adds an object of type T to the Codex
+     *
+     * This function takes a unique_ptr to an instance of Thing (or a subclass) and
+     * adds it to the Codex. The Codex assumes ownership going forward
+     * This method is threadsafe.
+     *
+     * @tparam T The type of the object to be added. Must be a subclass of Thing
+     *
+     * @param ptr The unique ptr owning the object to be added
+     *
+     * @return A raw pointer to the object
+    */
+    template<typename T>
+    T* add(std::unique_ptr<T> ptr) {
+        T* result;
+        {
+            // in sharded mode add__unsafe() locks the shard itself
+            ShardLock lock{ _shard_index(ptr->get_id()), !kSharded };
+            result = add__unsafe<T>(std::move(ptr));
+        }
+        // a replaced Thing is destroyed once the lock is released
+        _reclaim_deferred();
+        return result;
+    }
+
+    /**
+     * @brief Adds many objects of type T to the Codex at once
+     *
+     * Like add__unsafe() for every element, but each shard's table gets sized for
+     * the whole batch up front and every UUID is hashed only once, so loading n
+     * Things is a single O(n) pass without any rehashing in between.
+     * The Codex assumes ownership going forward, `ptrs` is left with empty
+     * unique_ptrs.
+     * A UUID listed more than once is handled like consecutive add() calls: the last
+     * Thing with the UUID ends up in the Codex, the earlier ones are destroyed and
+     * get nullptr as their result.
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) every shard touched by the batch gets
+     * locked once, unless the calling thread already holds it.
+     *
+     * @tparam T The type of the objects to be added. Must be a subclass of Thing
+     *
+     * @param ptrs The unique ptrs owning the objects to be added
+     *
+     * @return Raw pointers to the objects, in the same order, nullptr for the
+     *         ones replaced within the batch
+    */
+    template<typename T>
+    std::vector<T*> add_many__unsafe(std::vector<std::unique_ptr<T>>&& ptrs) {
+        static_assert(std::is_base_of<Thing, T>::value, "T must inherit from Thing");
+        std::vector<T*> result;
+        result.reserve(ptrs.size());
+        std::vector<size_t> hashes;
+        hashes.reserve(ptrs.size());
+        size_t counts[kShardCount] = {};
+        uint64_t touched = 0;
+        for (const auto& ptr : ptrs) {
+            hashes.push_back(ptr->get_id().hash());
+            const size_t shard = _shard_index_for_hash(hashes.back());
+            counts[shard]++;
+            touched |= 1ull << shard;
+        }
+
+        // Things replaced by an entry with the same UUID are destroyed after unlocking
+        std::vector<ThingPtr> replaced;
+        {
+            AllShardsLock lock{ touched, _self_locking(), Access::EXCLUSIVE };
+            Shard* shards = _get_shards();
+            for (size_t shard = 0; shard < kShardCount; shard++) {
+                if (counts[shard] == 0) continue;
+                shards[shard].mapping.reserve(shards[shard].mapping.size() + counts[shard]);
+                if (kLockFreeReads) shards[shard].index.reserve(counts[shard]);
+            }
+            for (size_t idx = 0; idx < ptrs.size(); idx++) {
+                const size_t shard = _shard_index_for_hash(hashes[idx]);
+                const Uuid uuid = ptrs[idx]->get_id();
+                result.push_back(ptrs[idx].get());
+                ThingPtr& entry = shards[shard].mapping.find_or_insert(uuid, hashes[idx]);
+                const bool replacing = static_cast<bool>(entry);
+                if (replacing) {
+                    _release_slot(shard, entry.get());
+                    replaced.push_back(std::move(entry));
+                }
+                entry = std::move(ptrs[idx]);
+                _assign_slot(shard, entry.get());
+                if (kLockFreeReads) shards[shard].index.insert(uuid, entry.get());
+                // counts as a removal once the replaced Thing can't be found anymore, see Ref
+                if (replacing) shards[shard].removals.fetch_add(1, std::memory_order_release);
+            }
+        }
+        if (!replaced.empty()) {
+            // a UUID listed twice replaced the Thing added for it earlier in the batch
+            std::vector<const Thing*> gone;
+            gone.reserve(replaced.size());
+            for (const auto& thing : replaced) gone.push_back(thing.get());
+            std::sort(gone.begin(), gone.end(), std::less<const Thing*>());
+            for (auto& thing : result) {
+                if (std::binary_search(gone.begin(), gone.end(), static_cast<const Thing*>(thing), std::less<const Thing*>())) thing = nullptr;
+            }
+        }
+        for (auto& thing : replaced) _retire(std::move(thing));
+        _reclaim_deferred();
+        return result;
+    }
+
+    /**
+     * @brief Adds many objects of type T to the Codex at once
+     *
+     * Same as add_many__unsafe(), but the Codex is locked once for the whole batch.
+     * This method is threadsafe.
+     *
+     * @tparam T The type of the objects to be added. Must be a subclass of Thing
+     *
+     * @param ptrs The unique ptrs owning the objects to be added
+     *
+     * @return Raw pointers to the objects, in the same order
+    */
+    template<typename T>
+    std::vector<T*> add_many(std::vector<std::unique_ptr<T>>&& ptrs) {
+        std::vector<T*> result;
+        {
+            // in sharded mode add_many__unsafe() locks the shards itself
+            AllShardsLock lock{ !kSharded };
+            result = add_many__unsafe<T>(std::move(ptrs));
+        }
+        _reclaim_deferred();
+        return result;
+    }
+
+    /**
+     * @brief Receives the references of a Thing, see Thing::visit_refs()
+    */
+    class RefVisitor {
+    public:
+        virtual ~RefVisitor() {}
+
+        /**
+         * @brief Reports a reference by UUID, UUIDs not in the Codex are ignored
+        */
+        virtual void visit(const Uuid& uuid) = 0;
+
+        /**
+         * @brief Reports a reference by Handle, stale Handles are ignored
+        */
+        virtual void visit(const Handle<Thing>& handle) = 0;
+    };
+
+    // Base object for Codex
+    class Thing {
+    private:
+        const Uuid _uuid;
+        // set while the Thing is in the Codex, see get_handle()
+        uint32_t _handle_index = 0;
+        uint32_t _handle_generation = 0;
+        // set once the Thing has been part of a link() or relate(), shard lock holder only
+        bool _linked = false;
+        // set while remove_cascade_incremental() works its way down to the Thing, hides it from get()
+        std::atomic<bool> _pending{ false };
+        // the Codex the Thing has been added to
+        CodexState* _codex = nullptr;
+
+        friend class ThingAccess;
+
+    public:
+        /**
+         * @brief create() becomes the defacto 'constructor' to be used to create Thing objects
+         *
+         * While this could be implemented however one likes, the important part is that after creating
+         * a unique ptr, it needs to get passed to add() for the codex to take ownership. This cant be
+         * part of the constructor as there is no clean way to turn `this` into a unique_ptr.
+         * Personally I like `create()` as it can mimic the signature of the actual constructor and just
+         * pass along the arguments.
+         * emplace() does both in one step and keeps Things of the same type together in a pool,
+         * so subclasses should prefer `return emplace<Derived>(args...);` over add().
+        */
+        static Thing* create() {
+            return emplace<Thing>();
+        }
+
+        Thing() : _uuid(_new_uuid()) {};
+
+        /**
+         * @brief Copies keep the UUID, but start out as not being part of any Codex
+         *
+         * Adding the copy replaces the original, see add(). Handle, links and Codex
+         * belong to the original and aren't copied.
+        */
+        Thing(const Thing& other) : _uuid(other._uuid) {};
+
+        // Thing is the root of the type information, see DH_CODEX_THING
+        using _dh_codex_self = Thing;
+        static const TypeInfo* static_type_info() {
+            static const TypeInfo info{ "Thing", nullptr };
+            return &info;
+        }
+
+        /**
+         * @brief Type information of the most derived registered class
+         *
+         * Overridden by DH_CODEX_THING, don't override it manually.
+        */
+        virtual const TypeInfo* get_type_info() const { return static_type_info(); }
+
+        /**
+         * @brief The destructor gets called when a Thing is removed from the Codex
+         * 
+         * Removing should always happen through `remove()` as this locks a mutex to
+         * prevent the Codex from getting out of sync with other threads. 
+         * `remove()` only unlinks the Thing under the lock, the destructor runs after the
+         * lock has been released, so an expensive destructor doesn't stall other threads.
+         * Prefer on_remove() for updating other Things, by the time the destructor runs
+         * the rest of the batch may already be gone.
+         * When removing dependencies from a node (eg children), call `remove__unsafe()`.
+         * While destructors run, the __unsafe functions lock what they need themselves,
+         * and the removed dependencies are queued and destroyed one after another
+         * instead of recursively.
+         * With DH_CODEX_BACKGROUND_RECLAIM the destructor runs on a background thread,
+         * see reclaim().
+         * If you create new threads in the destructor, you are on your own... Thats way
+         * beyond my knowledge. Try to avoid it if possible :)
+        */
+        virtual ~Thing() {};
+
+        /**
+         * @brief uuid getter
+         *
+         * @return uuid as string
+        */
+        const std::string get_uuid() const { return this->_uuid.to_string(); }
+
+        /**
+         * @brief Binary uuid getter
+         *
+         * Prefer this over get_uuid() when storing relationships or querying the
+         * Codex, it avoids the conversion to and from the string representation.
+         *
+         * @return uuid
+        */
+        const Uuid& get_id() const { return this->_uuid; }
+
+        /**
+         * @brief Handle getter
+         *
+         * Handles resolve faster than UUIDs, see Handle<T>. A Thing that has not
+         * been added to the Codex yet returns a null Handle.
+         *
+         * @return handle
+        */
+        Handle<Thing> get_handle() const { return Handle<Thing>(this->_handle_index, this->_handle_generation); }
+
+        /**
+         * @brief UUIDs of the Things to be removed along with this one, see remove_cascade()
+         *
+         * Override this instead of removing dependencies from the destructor when
+         * hierarchies can get deep, remove_cascade() collects them without recursing.
+         * Called while the Codex is locked, so don't add or remove Things from here.
+         *
+         * @param out The UUIDs get appended to this
+        */
+        virtual void dependents(std::vector<Uuid>& /* out */) const {}
+
+        /**
+         * @brief Reports the Things this one references, see collect()
+         *
+         * Call `visitor.visit()` for every UUID or Handle the Thing holds on to.
+         * May be called from several threads at once while the Codex is locked, so
+         * only read the Thing's own members from here, don't call into the Codex.
+         *
+         * @param visitor Receives the references
+        */
+        virtual void visit_refs(RefVisitor& /* visitor */) const {}
+
+        /**
+         * @brief Called when a Thing this one links to has been removed, see link()
+         *
+         * The link is already gone. Called with the shard of this Thing locked, so
+         * only update the Thing itself from here, don't call into the Codex.
+         *
+         * @param referent The UUID of the removed Thing
+        */
+        virtual void on_referent_removed(const Uuid& /* referent */) {}
+
+        /**
+         * @brief Called when the Thing has been removed from the Codex, right before it's destroyed
+         *
+         * The Thing is already unlinked but still fully alive, use this to update
+         * the Things depending on it (eg remove its UUID from the parent's children).
+         * Called without the Codex being locked, the __unsafe functions lock what
+         * they need themselves in here. Not called for Things still in the Codex at exit.
+        */
+        virtual void on_remove() {}
+
+        /**
+         * @brief Called once per type for all Things of that type removed together
+         *
+         * remove_many() and remove_cascade() hand their Things over in one batch,
+         * grouped by dynamic type, in removal order. `things` all have the same
+         * dynamic type as `this` and include it. The default calls on_remove() for
+         * each of them. Override it to handle many removals at once, eg erasing
+         * 50k children from their parent's list in one pass instead of 50k.
+         *
+         * @param things The removed Things
+         * @param count The number of Things in `things`
+        */
+        virtual void on_remove_batch(Thing* const* things, size_t count) {
+            for (size_t idx = 0; idx < count; idx++) things[idx]->on_remove();
+        }
+
+        /**
+         * @brief Generates a simple string representation of the object
+         *
+         * @return UUID
+        */
+        virtual const std::string get_repr() const {
+            return "<'" + std::string(typeid(*this).name()) + "' object at [" + this->get_uuid() + "]>";
+        };
+    };
+
+namespace detail {
+    template <typename T>
+    T* _thing_cast(Thing* thing, std::true_type /* registered */) {
+        return thing->get_type_info()->is_a(T::static_type_info()) ? static_cast<T*>(thing) : nullptr;
+    }
+
+    template <typename T>
+    T* _thing_cast(Thing* thing, std::false_type /* registered */) {
+        return dynamic_cast<T*>(thing);
+    }
+};
+
+    /**
+     * @brief Cast a Thing to T if it is one
+     *
+     * Constant time check and a static_cast if T has been registered with
+     * DH_CODEX_THING, otherwise a plain dynamic_cast.
+     *
+     * @tparam T The type to cast to
+     *
+     * @param thing The Thing to cast, may be nullptr
+     *
+     * @return `thing` as T or nullptr if it isn't a T
+    */
+    template <typename T>
+    T* thing_cast(Thing* thing) {
+        static_assert(std::is_base_of<Thing, T>::value, "<T> must be a subclass of Thing");
+        if (thing == nullptr) return nullptr;
+        return _thing_cast<T>(thing, std::is_same<typename T::_dh_codex_self, typename std::remove_cv<T>::type>());
+    }
+
+    class ThingAccess {
+    public:
+        static void set_handle(Thing* thing, uint32_t index, uint32_t generation) {
+            thing->_handle_index = index;
+            thing->_handle_generation = generation;
+        }
+
+        static void set_linked(Thing* thing) {
+            thing->_linked = true;
+        }
+
+        static bool linked(const Thing* thing) {
+            return thing->_linked;
+        }
+
+        static void set_codex(Thing* thing, CodexState* codex) {
+            thing->_codex = codex;
+        }
+
+        static CodexState* codex(const Thing* thing) {
+            return thing->_codex;
+        }
+
+        static void set_pending(Thing* thing) {
+            thing->_pending.store(true, std::memory_order_release);
+        }
+
+        static bool pending(const Thing* thing) {
+            return thing->_pending.load(std::memory_order_acquire);
+        }
+    };
+
+namespace detail {
+    inline Thing* _visible(Thing* thing) {
+        return (thing != nullptr && ThingAccess::pending(thing)) ? nullptr : thing;
+    }
+
+    /**
+     * @brief One bit per handle index, can be set from many threads at once
+     *
+     * Sized for the slots in use when it's created, so the Codex has to stay locked
+     * while it's used.
+    */
+    class SlotBitmap {
+    private:
+        std::unique_ptr<std::atomic<uint64_t>[]> _words;
+        size_t _size;
+
+    public:
+        explicit SlotBitmap(size_t bits) : _words(new std::atomic<uint64_t>[(bits + 63) / 64]()), _size(bits) {}
+
+        /**
+         * @brief Number of bits, handle indices from here on can't be set
+        */
+        size_t size() const { return this->_size; }
+
+        /**
+         * @brief Sets the bit for `index`
+         *
+         * @return true if the bit hasn't been set before
+        */
+        bool set(uint32_t index) {
+            std::atomic<uint64_t>& word = this->_words[index / 64];
+            const uint64_t bit = 1ull << (index % 64);
+            if (word.load(std::memory_order_relaxed) & bit) return false;
+            return !(word.fetch_or(bit, std::memory_order_relaxed) & bit);
+        }
+
+        bool test(uint32_t index) const {
+            return (this->_words[index / 64].load(std::memory_order_relaxed) >> (index % 64)) & 1;
+        }
+    };
+
+    enum class GcPhase {
+        IDLE = 0,
+        MARKING,
+        SWEEPING
+    };
+
+    /**
+     * @brief State of the incremental collection shared with add() and write_barrier() (per Codex)
+     *
+     * `phase` only changes while all shards are locked, `marked` is only replaced
+     * then. The rest is guarded by `mutex`, taken after any shard locks.
+    */
+    struct GcBarrier {
+        std::atomic<GcPhase> phase{ GcPhase::IDLE };
+        Mutex mutex;
+        std::unique_ptr<SlotBitmap> marked;
+        // Things added while marking, already marked but not scanned yet
+        std::vector<Handle<Thing>> added;
+        // references reported by write_barrier() while marking
+        std::vector<Uuid> shaded_uuids;
+        std::vector<Handle<Thing>> shaded_handles;
+    };
+
+    inline GcBarrier* _get_gc_barrier();
+
+    /**
+     * @brief Things added during an incremental collection survive it, and get scanned while marking
+    */
+    inline void _gc_added(const Handle<Thing>& handle) {
+        GcBarrier* gc = _get_gc_barrier();
+        if (gc->phase.load(std::memory_order_relaxed) == GcPhase::IDLE) return;
+        std::lock_guard<Mutex> lock{ gc->mutex };
+        if (gc->phase.load(std::memory_order_relaxed) == GcPhase::IDLE) return;
+        if (handle.index < gc->marked->size()) gc->marked->set(handle.index);
+        if (gc->phase.load(std::memory_order_relaxed) == GcPhase::MARKING) gc->added.push_back(handle);
+    }
+
+    inline void _gc_shade(const Uuid& uuid) {
+        GcBarrier* gc = _get_gc_barrier();
+        if (gc->phase.load(std::memory_order_acquire) != GcPhase::MARKING) return;
+        std::lock_guard<Mutex> lock{ gc->mutex };
+        if (gc->phase.load(std::memory_order_relaxed) == GcPhase::MARKING) gc->shaded_uuids.push_back(uuid);
+    }
+
+    inline void _gc_shade(const Handle<Thing>& handle) {
+        GcBarrier* gc = _get_gc_barrier();
+        if (handle.is_null() || gc->phase.load(std::memory_order_acquire) != GcPhase::MARKING) return;
+        std::lock_guard<Mutex> lock{ gc->mutex };
+        if (gc->phase.load(std::memory_order_relaxed) == GcPhase::MARKING) gc->shaded_handles.push_back(handle);
+    }
+
+    inline void _assign_slot(size_t shard, Thing* thing) {
+        uint32_t generation;
+        const uint32_t slot = _get_shards()[shard].slots.acquire(thing, &generation);
+        ThingAccess::set_handle(thing, _handle_index(shard, slot), generation);
+        ThingAccess::set_codex(thing, _codex_state());
+        _gc_added(Handle<Thing>(_handle_index(shard, slot), generation));
+    }
+
+    inline void _release_slot(size_t shard, Thing* thing) {
+        _get_shards()[shard].slots.release(_handle_slot(thing->get_handle().index));
+    }
+
+    /**
+     * @brief Takes the Thing with `uuid` out of all of the shard's structures, shard lock holder only
+    */
+    inline ThingPtr _unlink__unsafe(size_t shard, const Uuid& uuid, bool* found) {
+        ThingPtr thing = _get_shards()[shard].mapping.extract(uuid, found);
+        if (!*found) return thing;
+        _release_slot(shard, thing.get());
+        if (kLockFreeReads) _get_shards()[shard].index.erase(uuid);
+        // only once the Thing can't be found anymore, see Ref::_resolve()
+        _get_shards()[shard].removals.fetch_add(1, std::memory_order_release);
+        return thing;
+    }
+
+    inline void ThingDeleter::operator()(Thing* thing) const {
+        if (this->storage != nullptr) this->storage->release(thing);
+        else delete thing;
+    }
+
+    /**
+     * @brief Runs the destructor of an unlinked Thing, flagged as deferred destruction
+    */
+    inline void _destroy(ThingPtr thing) {
+        // the destructor may remove further Things from its own Codex
+        CodexScope scope{ _codex_data(ThingAccess::codex(thing.get())) };
+        _destruction_depth()++;
+        thing.reset();
+        _destruction_depth()--;
+    }
+
+    template<typename Pool>
+    void _destroy_retired(void* thing) {
+        _destroy(ThingPtr(static_cast<Thing*>(thing), ThingDeleter(Pool::storage())));
+    }
+
+    // _destroy_retired() for Things allocated with `new`
+    inline void _destroy_retired_heap(void* thing) {
+        _destroy(ThingPtr(static_cast<Thing*>(thing)));
+    }
+
+    /**
+     * @brief The calling thread's list of unlinked Things waiting for their destructor
+     *
+     * nullptr once the thread is exiting, see _dispose()
+    */
+    inline std::vector<ThingPtr>* _retire_list() {
+        // trivially destructible, so it can still be read while thread locals are torn down
+        thread_local bool exited = false;
+        struct RetireList {
+            bool* exited;
+            std::vector<ThingPtr> things;
+            ~RetireList() { *this->exited = true; }
+        };
+        if (exited) return nullptr;
+        thread_local RetireList list{ &exited, {} };
+        return &list.things;
+    }
+
+    /**
+     * @brief Both directions of one relation, see relation()
+    */
+    struct RelationStore {
+        std::string name;
+        RelationMutex mutex;
+        Adjacency out;
+        Adjacency in;
+    };
+
+    /**
+     * @brief Registry of the relations (per Codex)
+     *
+     * Stores are only freed with the Codex and never moved, so they can be looked up
+     * by id without locking.
+    */
+    struct Relations {
+        static constexpr size_t kMaxRelations = 256;
+        Mutex mutex;
+        std::atomic<RelationStore*> stores[kMaxRelations] = {};
+        std::atomic<uint32_t> count{ 0 };
+
+        Relations() = default;
+        Relations(const Relations&) = delete;
+        Relations& operator=(const Relations&) = delete;
+        ~Relations() {
+            for (auto& store : this->stores) delete store.load();
+        }
+    };
+
+    inline Relations* _get_relations();
+
+    inline RelationStore* _relation_store(const Relation& relation) {
+        return _get_relations()->stores[relation.id].load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Read locks a relation, unless the calling thread already has it read locked
+     *
+     * The lock prefers writers, so a nested lock_shared() could wait for a writer
+     * that waits for the outer one.
+    */
+    inline uint32_t& _relation_read_depth(const RelationStore* store) {
+        // a thread only ever holds a handful of relations at once
+        thread_local std::vector<std::pair<const RelationStore*, uint32_t>> depths;
+        std::pair<const RelationStore*, uint32_t>* unused = nullptr;
+        for (auto& depth : depths) {
+            if (depth.first == store) return depth.second;
+            if (depth.second == 0) unused = &depth;
+        }
+        if (unused == nullptr) {
+            depths.emplace_back(store, 0);
+            unused = &depths.back();
+        }
+        unused->first = store;
+        return unused->second;
+    }
+
+    inline void _lock_relation_shared(RelationStore* store) {
+        if (_relation_read_depth(store)++ == 0) store->mutex.lock_shared();
+    }
+
+    inline void _unlock_relation_shared(RelationStore* store) {
+        if (--_relation_read_depth(store) == 0) store->mutex.unlock_shared();
+    }
+
+    /**
+     * @brief Drops all edges from and to a removed Thing, see relate()
+     *
+     * Runs without any shard lock held, relations are locked before the shards.
+    */
+    inline void _drop_relations(const Thing* thing) {
+        Relations* relations = _get_relations();
+        const uint32_t count = relations->count.load(std::memory_order_acquire);
+        const Uuid& uuid = thing->get_id();
+        for (uint32_t id = 0; id < count; id++) {
+            RelationStore* store = relations->stores[id].load(std::memory_order_acquire);
+            std::lock_guard<RelationMutex> lock{ store->mutex };
+            for (const auto& neighbor : store->out.extract(uuid)) store->in.erase(neighbor, uuid);
+            for (const auto& neighbor : store->in.extract(uuid)) store->out.erase(neighbor, uuid);
+        }
+    }
+
+    /**
+     * @brief Drops all links from and to a removed Thing and tells its referrers, see link()
+     *
+     * Runs without any lock held. Nothing can link to the Thing anymore once it has
+     * been unlinked, so the shards collected in the first pass are all it takes.
+    */
+    inline void _drop_links(const Thing* thing) {
+        if (!ThingAccess::linked(thing)) return;
+        _drop_relations(thing);
+        const Uuid& uuid = thing->get_id();
+        const size_t shard = _shard_index(uuid);
+        Shard* shards = _get_shards();
+        uint64_t touched = 1ull << shard;
+        {
+            ShardLock lock{ shard };
+            auto add_shard = [&touched](const Uuid& other) { touched |= 1ull << _shard_index(other); };
+            const UuidSet* referents = shards[shard].referents.find(uuid);
+            const UuidSet* referrers = shards[shard].referrers.find(uuid);
+            if (referents != nullptr) referents->for_each(add_shard);
+            if (referrers != nullptr) referrers->for_each(add_shard);
+        }
+
+        AllShardsLock lock{ touched, true, Access::EXCLUSIVE };
+        const UuidSet referents = shards[shard].referents.extract(uuid);
+        const UuidSet referrers = shards[shard].referrers.extract(uuid);
+        referents.for_each([&](const Uuid& referent) {
+            FlatMap<UuidSet>& sets = shards[_shard_index(referent)].referrers;
+            UuidSet* set = sets.find(referent);
+            if (set != nullptr && set->erase(uuid) && set->empty()) sets.erase(referent);
+        });
+        referrers.for_each([&](const Uuid& referrer) {
+            Shard& other = shards[_shard_index(referrer)];
+            UuidSet* set = other.referents.find(referrer);
+            if (set != nullptr && set->erase(uuid) && set->empty()) other.referents.erase(referrer);
+            ThingPtr* entry = other.mapping.find(referrer);
+            if (entry != nullptr) (*entry)->on_referent_removed(uuid);
+        });
+    }
+
+    /**
+     * @brief Calls on_remove_batch() once per dynamic type of the Things in `things`, then drops their links
+    */
+    inline void _notify_removed(std::vector<ThingPtr>& things) {
+        // hooks run with the Codex of their Things current
+        if (things.size() == 1) {
+            Thing* thing = things[0].get();
+            CodexScope scope{ _codex_data(ThingAccess::codex(thing)) };
+            thing->on_remove_batch(&thing, 1);
+            _drop_links(thing);
+            return;
+        }
+        std::vector<Thing*> sorted;
+        sorted.reserve(things.size());
+        for (auto& thing : things) sorted.push_back(thing.get());
+        std::stable_sort(sorted.begin(), sorted.end(), [](Thing* a, Thing* b) {
+            if (ThingAccess::codex(a) != ThingAccess::codex(b)) return std::less<CodexState*>()(ThingAccess::codex(a), ThingAccess::codex(b));
+            return typeid(*a).before(typeid(*b));
+        });
+        size_t start = 0;
+        for (size_t idx = 1; idx <= sorted.size(); idx++) {
+            if (idx < sorted.size() && ThingAccess::codex(sorted[idx]) == ThingAccess::codex(sorted[start]) && typeid(*sorted[idx]) == typeid(*sorted[start])) continue;
+            CodexScope scope{ _codex_data(ThingAccess::codex(sorted[start])) };
+            sorted[start]->on_remove_batch(sorted.data() + start, idx - start);
+            start = idx;
+        }
+        for (auto& thing : things) {
+            CodexScope scope{ _codex_data(ThingAccess::codex(thing.get())) };
+            _drop_links(thing.get());
+        }
+    }
+
+    /**
+     * @brief Destroys the Things in `things`, with DH_CODEX_LOCKFREE_READS they are retired instead
+    */
+    inline void _destroy_all(std::vector<ThingPtr>& things) {
+        for (auto& thing : things) {
+            if (!kLockFreeReads) {
+                _destroy(std::move(thing));
+                continue;
+            }
+            const ThingStorage* storage = thing.get_deleter().storage;
+            _get_epoch_domain()->retire(thing.release(), (storage != nullptr) ? storage->retire : &_destroy_retired_heap);
+        }
+        things.clear();
+    }
+
+    class Reclaimer;
+
+    /**
+     * @brief Works off a retire list until it stays empty
+     *
+     * Defined after Reclaimer.
+    */
+    inline void _drain(std::vector<ThingPtr>& list, Reclaimer* reclaimer);
+
+#ifdef DH_CODEX_BACKGROUND_RECLAIM
+    static constexpr bool kBackgroundReclaim = true;
+#else
+    static constexpr bool kBackgroundReclaim = false;
+#endif
+
+    /**
+     * @brief Background thread running the destructors of removed Things (DH_CODEX_BACKGROUND_RECLAIM)
+     *
+     * Threads run the removal hooks, then hand their retire lists over and return
+     * right away. Cascading removals from the destructors end up on the reclaimer's
+     * own retire list and are worked off the same way. With DH_CODEX_LOCKFREE_READS,
+     * the reclaimer retires the Things and runs the epoch domain's reclaim().
+    */
+    class Reclaimer {
+    private:
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _idle;
+        std::vector<ThingPtr> _queue;
+        bool _poked = false;
+        bool _busy = false;
+        bool _stop = false;
+        std::thread _thread;
+
+        void _run() {
+            std::unique_lock<std::mutex> lock{ this->_mutex };
+            while (true) {
+                this->_wake.wait(lock, [this]() { return this->_stop || this->_poked || !this->_queue.empty(); });
+                if (!this->_poked && this->_queue.empty()) break;
+
+                std::vector<ThingPtr> batch;
+                batch.swap(this->_queue);
+                this->_poked = false;
+                this->_busy = true;
+                lock.unlock();
+                // the hooks already ran on the removing thread
+                _destroy_all(batch);
+                _drain(*_retire_list(), nullptr);
+                lock.lock();
+                this->_busy = false;
+                this->_idle.notify_all();
+            }
+        }
+
+    public:
+        Reclaimer() : _thread([this]() { this->_run(); }) {}
+
+        ~Reclaimer() {
+            {
+                std::lock_guard<std::mutex> lock{ this->_mutex };
+                this->_stop = true;
+            }
+            this->_wake.notify_all();
+            this->_thread.join();
+        }
+
+        Reclaimer(const Reclaimer&) = delete;
+        Reclaimer& operator=(const Reclaimer&) = delete;
+
+        /**
+         * @brief Takes over all Things in `things` and wakes the reclaimer
+        */
+        void push(std::vector<ThingPtr>& things) {
+            {
+                std::lock_guard<std::mutex> lock{ this->_mutex };
+                if (this->_queue.empty()) this->_queue.swap(things);
+                else for (auto& thing : things) this->_queue.push_back(std::move(thing));
+                this->_poked = true;
+            }
+            things.clear();
+            this->_wake.notify_one();
+        }
+
+        /**
+         * @brief Wakes the reclaimer to run the epoch domain's reclaim() (DH_CODEX_LOCKFREE_READS)
+        */
+        void poke() {
+            {
+                std::lock_guard<std::mutex> lock{ this->_mutex };
+                this->_poked = true;
+            }
+            this->_wake.notify_one();
+        }
+
+        /**
+         * @brief Blocks until everything handed over so far has been destroyed
+        */
+        void wait() {
+            std::unique_lock<std::mutex> lock{ this->_mutex };
+            this->_idle.wait(lock, [this]() { return !this->_busy && !this->_poked && this->_queue.empty(); });
+        }
+    };
+
+    /**
+     * @brief Getter for the background reclaimer (global)
+     *
+     * nullptr once it has been shut down at exit, Things are destroyed inline after that
+    */
+    inline Reclaimer* _get_reclaimer() {
+        // trivially destructible, so it can still be read after the reclaimer is gone
+        static bool exited = false;
+        struct Holder {
+            bool* exited;
+            Reclaimer reclaimer;
+            explicit Holder(bool* exited) : exited(exited) {}
+            ~Holder() { *this->exited = true; }
+        };
+        if (exited) return nullptr;
+        static Holder holder{ &exited };
+        return &holder.reclaimer;
+    }
+
+    inline void _drain(std::vector<ThingPtr>& list, Reclaimer* reclaimer) {
+        // runs as deferred destruction, Things removed from hooks and destructors
+        // are appended to `list` and picked up by the next round instead of recursing
+        std::vector<ThingPtr> batch;
+        _destruction_depth()++;
+        while (true) {
+            while (!list.empty()) {
+                batch.swap(list);
+                _notify_removed(batch);
+                if (reclaimer != nullptr) reclaimer->push(batch);
+                else _destroy_all(batch);
+            }
+            if (!kLockFreeReads) break;
+            if (reclaimer != nullptr) {
+                reclaimer->poke();
+                break;
+            }
+            _get_epoch_domain()->reclaim();
+            if (list.empty()) break;
+        }
+        _destruction_depth()--;
+        // keeps the capacity around for the next removal
+        list.swap(batch);
+    }
+
+    /**
+     * @brief Runs the removal hooks and destroys the Things removed by the calling thread
+     *
+     * Only does something while the calling thread doesn't hold any shard and
+     * isn't already running hooks or destructors: Things removed from those are
+     * appended to the retire list and picked up by _drain() instead of recursing.
+    */
+    inline void _reclaim_deferred() {
+        if (_any_shards_held() || _destruction_depth() > 0) return;
+        std::vector<ThingPtr>* list = _retire_list();
+        Reclaimer* reclaimer = kBackgroundReclaim ? _get_reclaimer() : nullptr;
+        if (list != nullptr) _drain(*list, reclaimer);
+        else if (kLockFreeReads && reclaimer != nullptr) reclaimer->poke();
+        else if (kLockFreeReads) _get_epoch_domain()->reclaim();
+    }
+
+    inline void _retire(ThingPtr thing) {
+        std::vector<ThingPtr>* list = _retire_list();
+        if (list != nullptr) {
+            list->push_back(std::move(thing));
+            return;
+        }
+        // the thread is exiting, no retire list to queue on anymore
+        std::vector<ThingPtr> single;
+        single.push_back(std::move(thing));
+        _destruction_depth()++;
+        _notify_removed(single);
+        _destroy_all(single);
+        _destruction_depth()--;
+    }
+
+    inline void _dispose(ThingPtr thing) {
+        if (thing) _retire(std::move(thing));
+        _reclaim_deferred();
+    }
+
+    /**
+     * @brief Constructs a T in its SlabPool, not added to the Codex yet, see emplace()
+    */
+    template<typename T, typename... Args>
+    std::unique_ptr<T, ThingDeleter> _construct(Args&&... args) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over aligned Things can't be emplaced, use add()");
+        SlabPool<T>& pool = SlabPool<T>::instance();
+        void* memory = pool.allocate();
+        T* thing;
+        try {
+            thing = new (memory) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            pool.deallocate(memory);
+            throw;
+        }
+        return std::unique_ptr<T, ThingDeleter>(thing, ThingDeleter(SlabPool<T>::storage()));
+    }
+};
+
+    /**
+     * @brief Constructs a T in Codex owned storage and adds it to the Codex
+     *
+     * Unlike add(std::make_unique<T>(...)), the object is constructed straight
+     * into its type's SlabPool: no general purpose heap allocation, and Things of
+     * the same type end up next to each other in memory. Removing the Thing
+     * returns its memory to the pool.
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) the shard of the UUID gets locked
+     * unless the calling thread already holds it.
+     *
+     * @tparam T The type of the object to be created. Must be a subclass of Thing
+     *
+     * @param args The arguments passed on to T's constructor
+     *
+     * @return A raw pointer to the object
+    */
+    template<typename T, typename... Args>
+    T* emplace__unsafe(Args&&... args) {
+        static_assert(std::is_base_of<Thing, T>::value, "T must inherit from Thing");
+        return _add__unsafe<T>(_construct<T>(std::forward<Args>(args)...));
+    }
+
+    /**
+     * @brief Constructs a T in Codex owned storage and adds it to the Codex
+     *
+     * See emplace__unsafe()
+     * This method is threadsafe.
+     *
+     * @tparam T The type of the object to be created. Must be a subclass of Thing
+     *
+     * @param args The arguments passed on to T's constructor
+     *
+     * @return A raw pointer to the object
+    */
+    template<typename T, typename... Args>
+    T* emplace(Args&&... args) {
+        T* result;
+        {
+            // the UUID is only known once T is constructed, so in unsharded mode the
+            // construction happens under the lock as well
+            ShardLock lock{ 0, !kSharded };
+            result = emplace__unsafe<T>(std::forward<Args>(args)...);
+        }
+        _reclaim_deferred();
+        return result;
+    }
+
+    /**
+     * @brief Keeps Things returned by get() alive while other threads remove them
+     *
+     * With DH_CODEX_LOCKFREE_READS, get() doesn't lock and a removed Thing is only
+     * destroyed once no reader can see it anymore. get() itself only protects the
+     * lookup, so hold a ReadGuard for as long as you use the returned pointers.
+     * Guards can be nested. Without DH_CODEX_LOCKFREE_READS this does nothing.
+    */
+    class ReadGuard {
+    public:
+        ReadGuard() {
+            if (kLockFreeReads) _get_epoch_domain()->pin();
+        }
+        ~ReadGuard() {
+            if (kLockFreeReads) _get_epoch_domain()->unpin();
+        }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+
+    /**
+     * @brief Find one Thing with the given UUID and print an error if no object can be found
+     *
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) the shard of the UUID gets locked
+     * unless the calling thread already holds it.
+     *
+     * @tparam T The type of Thing to be retrieved
+     *
+     * @param uuid The UUID to query
+     *
+     * @return A pointer to the Thing if found, otherwise nullptr.
+    */
+    template <typename T = Thing>
+    T* get__unsafe(const Uuid& uuid) {
+        static_assert(std::is_base_of<Thing, T>::value, "<T> must be a subclass of Thing");
+        ShardLock lock{ _shard_index(uuid), _self_locking() && !kLockFreeReads, Access::SHARED };
+        EpochPin pin{ kLockFreeReads };
+        return _find_one_by_uuid__unsafe<T>(uuid);
+    };
+
+    /**
+     * @brief Find one Thing with the given UUID string
+     *
+     * Convenience overload, see get__unsafe(const Uuid&)
+     * This method is not thread safe.
+    */
+    template <typename T = Thing>
+    T* get__unsafe(const std::string& uuid) {
+        return get__unsafe<T>(Uuid::from_string(uuid));
+    };
+
+    /**
+     * @brief Find one Thing with the given UUID and print an error if no object can be found
+     *
+     * This method is threadsafe.
+     *
+     * @tparam T The type of Thing to be retrieved
+     *
+     * @param uuid The UUID to query
+     *
+     * @return A pointer to the Thing if found, otherwise nullptr.
+    */
+    template <typename T = Thing>
+    T* get(const Uuid& uuid) {
+        ShardLock lock{ _shard_index(uuid), !kLockFreeReads, Access::SHARED };
+        return get__unsafe<T>(uuid);
+    }
+
+    /**
+     * @brief Find one Thing with the given UUID string
+     *
+     * Convenience overload, see get(const Uuid&)
+     * This method is threadsafe.
+    */
+    template <typename T = Thing>
+    T* get(const std::string& uuid) {
+        return get<T>(Uuid::from_string(uuid));
+    }
+
+    /**
+     * @brief Find many Things at once
+     *
+     * Resolves `count` UUIDs into `out`, nullptr for every UUID that is not in the
+     * Codex (or not a T). The keys are hashed in small batches and their buckets
+     * prefetched before they are probed, so the lookups overlap their cache misses
+     * instead of paying for them one after another.
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) every shard touched by `uuids` gets
+     * locked once for the whole batch, unless the calling thread already holds it.
+     *
+     * @tparam T The type of Thing to be retrieved
+     *
+     * @param uuids The UUIDs to query
+     * @param count Number of UUIDs
+     * @param out Receives `count` pointers
+    */
+    template <typename T = Thing>
+    void get_many__unsafe(const Uuid* uuids, size_t count, T** out) {
+        static_assert(std::is_base_of<Thing, T>::value, "<T> must be a subclass of Thing");
+        uint64_t touched = 0;
+        const bool locking = _self_locking() && !kLockFreeReads;
+        if (locking) {
+            for (size_t idx = 0; idx < count; idx++) touched |= 1ull << _shard_index(uuids[idx]);
+        }
+        AllShardsLock lock{ touched, locking, Access::SHARED };
+        EpochPin pin{ kLockFreeReads };
+
+        _find_many_by_uuid__unsafe<T>(uuids, count, out);
+    }
+
+    /**
+     * @brief Find many Things at once
+     *
+     * Same as get_many__unsafe(), but the Codex is locked once for the whole batch
+     * (only the shards touched in sharded mode, not at all with lock free reads).
+     * This method is threadsafe.
+     *
+     * @tparam T The type of Thing to be retrieved
+     *
+     * @param uuids The UUIDs to query
+     * @param count Number of UUIDs
+     * @param out Receives `count` pointers
+    */
+    template <typename T = Thing>
+    void get_many(const Uuid* uuids, size_t count, T** out) {
+        // in sharded mode get_many__unsafe() locks the shards itself
+        AllShardsLock lock{ !kSharded && !kLockFreeReads, Access::SHARED };
+        get_many__unsafe<T>(uuids, count, out);
+    }
+
+    /**
+     * @brief Find many Things at once
+     *
+     * Convenience overload of get_many(const Uuid*, size_t, T**)
+     * This method is threadsafe.
+     *
+     * @return One pointer per UUID, nullptr where no Thing could be found
+    */
+    template <typename T = Thing>
+    std::vector<T*> get_many(const std::vector<Uuid>& uuids) {
+        std::vector<T*> result(uuids.size());
+        get_many<T>(uuids.data(), uuids.size(), result.data());
+        return result;
+    }
+
+    /**
+     * @brief Find many Things at once from their UUID strings
+     *
+     * Convenience overload of get_many(const Uuid*, size_t, T**)
+     * This method is threadsafe.
+     *
+     * @return One pointer per UUID, nullptr where no Thing could be found
+    */
+    template <typename T = Thing>
+    std::vector<T*> get_many(const std::vector<std::string>& uuids) {
+        std::vector<Uuid> ids;
+        ids.reserve(uuids.size());
+        for (const auto& uuid : uuids) ids.push_back(Uuid::from_string(uuid));
+        return get_many<T>(ids);
+    }
+
+    /**
+     * @brief Resolve a Handle
+     *
+     * One indexed load and a generation check, no hashing.
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) the shard of the Handle gets locked
+     * unless the calling thread already holds it.
+     *
+     * @tparam T The type of Thing referenced
+     *
+     * @param handle The Handle to resolve
+     *
+     * @return A pointer to the Thing or nullptr if it has been removed
+    */
+    template <typename T>
+    T* get__unsafe(const Handle<T>& handle) {
+        static_assert(std::is_base_of<Thing, T>::value, "<T> must be a subclass of Thing");
+        const size_t shard = _handle_shard(handle.index);
+        ShardLock lock{ shard, _self_locking() && !kLockFreeReads, Access::SHARED };
+        EpochPin pin{ kLockFreeReads };
+        return static_cast<T*>(_visible(_get_shards()[shard].slots.resolve(_handle_slot(handle.index), handle.generation)));
+    }
+
+    /**
+     * @brief Resolve a Handle
+     *
+     * One indexed load and a generation check, no hashing.
+     * This method is threadsafe.
+     *
+     * @tparam T The type of Thing referenced
+     *
+     * @param handle The Handle to resolve
+     *
+     * @return A pointer to the Thing or nullptr if it has been removed
+    */
+    template <typename T>
+    T* get(const Handle<T>& handle) {
+        ShardLock lock{ _handle_shard(handle.index), !kLockFreeReads, Access::SHARED };
+        return get__unsafe<T>(handle);
+    }
+
+    /**
+     * @brief Typed Handle of a Thing
+     *
+     * Same as thing->get_handle(), but keeps the type.
+     *
+     * @param thing A Thing in the Codex
+     *
+     * @return The Handle, or a null Handle if `thing` has not been added to the Codex
+    */
+    template <typename T>
+    Handle<T> handle_of(const T* thing) {
+        static_assert(std::is_base_of<Thing, T>::value, "<T> must be a subclass of Thing");
+        const Handle<Thing> handle = thing->get_handle();
+        return Handle<T>(handle.index, handle.generation);
+    }
+
+    /**
+     * @brief Look up the Handle of the Thing with the given UUID
+     *
+     * This method is threadsafe.
+     *
+     * @tparam T The type of Thing to be referenced
+     *
+     * @param uuid The UUID to query
+     *
+     * @return The Handle, or a null Handle if the UUID is not in the Codex or not a T
+    */
+    template <typename T = Thing>
+    Handle<T> get_handle(const Uuid& uuid) {
+        ShardLock lock{ _shard_index(uuid), !kLockFreeReads, Access::SHARED };
+        EpochPin pin{ kLockFreeReads };
+        T* thing = get__unsafe<T>(uuid);
+        return (thing != nullptr) ? handle_of(thing) : Handle<T>();
+    }
+
+    /**
+     * @brief Look up the UUID of the Thing a Handle references
+     *
+     * This method is threadsafe.
+     *
+     * @param handle The Handle to resolve
+     *
+     * @return The UUID, or a nil Uuid if the Thing has been removed
+    */
+    template <typename T>
+    Uuid get_id(const Handle<T>& handle) {
+        ShardLock lock{ _handle_shard(handle.index), !kLockFreeReads, Access::SHARED };
+        EpochPin pin{ kLockFreeReads };
+        T* thing = get__unsafe<T>(handle);
+        return (thing != nullptr) ? thing->get_id() : Uuid();
+    }
+
+    /**
+     * @brief Reference to a Thing by UUID that caches the Thing it resolved to
+     *
+     * Holds the UUID, the last resolved pointer and the removal count of the UUID's
+     * shard at the time. As long as no Thing has left that shard since, get() returns
+     * the cached pointer after two atomic loads and a compare, without locking,
+     * hashing or casting. Otherwise it looks the UUID up like get<T>() does.
+     * UUIDs are never reused, so a removal elsewhere in the shard only costs one
+     * lookup. Removed Things and UUIDs that aren't a T are never cached.
+     * The cache is only meaningful within the process, persist a Ref through
+     * get_id() or to_string(). Refs can be copied and dereferenced from any thread.
+     * Like get(), the returned pointer is only valid until the Thing is removed, so
+     * hold a ReadGuard while using it with DH_CODEX_LOCKFREE_READS.
+     *
+     * @tparam T The type of Thing referenced
+    */
+    template <typename T = Thing>
+    class Ref {
+    private:
+        static_assert(std::is_base_of<Thing, T>::value, "<T> must be a subclass of Thing");
+
+        // never a removal count, so a fresh Ref starts out unresolved
+        static constexpr uint64_t kUnresolved = UINT64_MAX;
+
+        Uuid _uuid;
+        mutable std::atomic<T*> _thing{ nullptr };
+        mutable std::atomic<uint64_t> _stamp{ kUnresolved };
+        // the Codex the Thing has been found in, see Codex
+        mutable std::atomic<uint64_t> _codex{ 0 };
+
+        T* _cached() const {
+            T* thing = this->_thing.load(std::memory_order_acquire);
+            if (thing == nullptr || this->_codex.load(std::memory_order_acquire) != _codex_serial()) return nullptr;
+            const uint64_t removals = _get_shards()[_shard_index(this->_uuid)].removals.load(std::memory_order_acquire);
+            // another thread might be storing a newer pointer and stamp at the same
+            // time, but every pointer ever cached is the same Thing
+            return (this->_stamp.load(std::memory_order_acquire) == removals) ? thing : nullptr;
+        }
+
+        /**
+         * @brief Looks the UUID up and caches the result, the caller holds the shard lock or is pinned
+        */
+        T* _resolve() const {
+            // read before the lookup, a removal racing with the lookup moves it on
+            const uint64_t removals = _get_shards()[_shard_index(this->_uuid)].removals.load(std::memory_order_acquire);
+            T* thing = _find_one_by_uuid__unsafe<T>(this->_uuid);
+            if (thing == nullptr) return nullptr;
+            this->_thing.store(thing, std::memory_order_release);
+            this->_stamp.store(removals, std::memory_order_release);
+            this->_codex.store(_codex_serial(), std::memory_order_release);
+            return thing;
+        }
+
+    public:
+        Ref() = default;
+        Ref(const Uuid& uuid) : _uuid(uuid) {}
+        explicit Ref(const std::string& uuid) : _uuid(Uuid::from_string(uuid)) {}
+        Ref(const T* thing) : _uuid((thing != nullptr) ? thing->get_id() : Uuid()) {}
+
+        Ref(const Ref& other)
+            : _uuid(other._uuid),
+              _thing(other._thing.load(std::memory_order_acquire)),
+              _stamp(other._stamp.load(std::memory_order_acquire)),
+              _codex(other._codex.load(std::memory_order_acquire)) {}
+
+        Ref& operator=(const Ref& other) {
+            this->_uuid = other._uuid;
+            this->_thing.store(other._thing.load(std::memory_order_acquire), std::memory_order_release);
+            this->_stamp.store(other._stamp.load(std::memory_order_acquire), std::memory_order_release);
+            this->_codex.store(other._codex.load(std::memory_order_acquire), std::memory_order_release);
+            return *this;
+        }
+
+        /**
+         * @brief The UUID of the referenced Thing, all there is to persist of a Ref
+        */
+        const Uuid& get_id() const { return this->_uuid; }
+        std::string to_string() const { return this->_uuid.to_string(); }
+        bool is_null() const { return this->_uuid.is_nil(); }
+
+        /**
+         * @brief Resolve the Ref
+         *
+         * This method is not thread safe and you could potentially run into
+         * issues if the codex is modified while this method is running on
+         * another thread.
+         * In sharded mode (DH_CODEX_SHARDS > 1) the shard of the UUID gets locked
+         * unless the calling thread already holds it, but only if the cached
+         * pointer can't be used.
+         *
+         * @return A pointer to the Thing, nullptr if it's not in the Codex or not a T
+        */
+        T* get__unsafe() const {
+            T* thing = this->_cached();
+            if (thing != nullptr) return thing;
+            ShardLock lock{ _shard_index(this->_uuid), _self_locking() && !kLockFreeReads, Access::SHARED };
+            EpochPin pin{ kLockFreeReads };
+            return this->_resolve();
+        }
+
+        /**
+         * @brief Resolve the Ref
+         *
+         * The shard of the UUID only gets locked if the cached pointer can't be used.
+         * This method is threadsafe.
+         *
+         * @return A pointer to the Thing, nullptr if it's not in the Codex or not a T
+        */
+        T* get() const {
+            T* thing = this->_cached();
+            if (thing != nullptr) return thing;
+            ShardLock lock{ _shard_index(this->_uuid), !kLockFreeReads, Access::SHARED };
+            EpochPin pin{ kLockFreeReads };
+            return this->_resolve();
+        }
+
+        T* operator->() const { return this->get(); }
+        T& operator*() const { return *this->get(); }
+        explicit operator bool() const { return this->get() != nullptr; }
+
+        bool operator==(const Ref& other) const { return this->_uuid == other._uuid; }
+        bool operator!=(const Ref& other) const { return this->_uuid != other._uuid; }
+    };
+
+    template <typename T> constexpr uint64_t Ref<T>::kUnresolved;
+
+    /**
+     * @brief Remove a Thing from the Codex via UUID
+     *
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * When removing nodes, you should generally use `remove()`. This locks
+     * a mutex to make a thread safe environment.
+     * The Thing is only unlinked under the lock, its destructor runs once the
+     * calling thread doesn't hold any lock anymore (see the destructor of Thing).
+     * Removals from within destructors are queued and worked off one after
+     * another instead of recursing.
+     * In sharded mode (DH_CODEX_SHARDS > 1), and while destructors run, the
+     * shard of the UUID gets locked unless the calling thread already holds it.
+     * That way no thread ever waits for a second shard while holding one, even
+     * when destructors cascade into other shards.
+     *
+     * @param uuid The UUID of the object to remove
+     *
+     * @return Status::SUCCESS or Status::Failure (if UUID not in Codex)
+    */
+    inline Status remove__unsafe(const Uuid& uuid) {
+        const size_t shard = _shard_index(uuid);
+        bool found = false;
+        ThingPtr removed;
+        {
+            ShardLock lock{ shard, _self_locking() };
+            removed = _unlink__unsafe(shard, uuid, &found);
+        }
+        if (found) _dispose(std::move(removed));
+        return found ? Status::SUCCESS : Status::FAILURE;
+    };
+
+    /**
+     * @brief Remove a Thing from the Codex via UUID string
+     *
+     * Convenience overload, see remove__unsafe(const Uuid&)
+     * This method is not thread safe.
+    */
+    inline Status remove__unsafe(const std::string& uuid) {
+        return remove__unsafe(Uuid::from_string(uuid));
+    };
+
+    /**
+     * @brief Remove a Thing from the Codex via UUID
+     *
+     * This method is threadsafe.
+     *
+     * @param uuid The UUID of the object to remove
+     *
+     * @return Status::SUCCESS or Status::Failure (if UUID not in Codex)
+    */
+    inline Status remove(const Uuid& uuid) {
+        Status status;
+        {
+            // in sharded mode remove__unsafe() locks the shard itself
+            ShardLock lock{ _shard_index(uuid), !kSharded };
+            status = remove__unsafe(uuid);
+        }
+        // the Thing (and whatever its destructor removes) is destroyed once the lock is released
+        _reclaim_deferred();
+        return status;
+    }
+
+    /**
+     * @brief Remove a Thing from the Codex via UUID string
+     *
+     * Convenience overload, see remove(const Uuid&)
+     * This method is threadsafe.
+    */
+    inline Status remove(const std::string& uuid) {
+        return remove(Uuid::from_string(uuid));
+    }
+
+    /**
+     * @brief Remove a Thing form the Codex via pointer
+     *
+     * This method is threadsafe.
+     *
+     * @param ptr A ptr to the Thing to remove
+     *
+     * @return Status::SUCCESS or Status::Failure (if UUID not in Codex)
+    */
+    inline Status remove(Thing* ptr) {
+        return remove(ptr->get_id());
+    }
+
+    /**
+     * @brief Remove a Thing form the Codex via Handle
+     *
+     * This method is threadsafe.
+     *
+     * @param handle The Handle of the Thing to remove
+     *
+     * @return Status::SUCCESS or Status::Failure (if the Handle is stale)
+    */
+    template <typename T>
+    Status remove(const Handle<T>& handle) {
+        const Uuid uuid = get_id(handle);
+        return uuid.is_nil() ? Status::FAILURE : remove(uuid);
+    }
+
+    /**
+     * @brief Remove many Things from the Codex at once
+     *
+     * The Things are unlinked under a single lock and their removal hooks see them
+     * as one batch, see Thing::on_remove_batch(). UUIDs not in the Codex (or
+     * listed twice) are skipped.
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) every shard touched by the batch gets
+     * locked once, unless the calling thread already holds it.
+     *
+     * @param uuids The UUIDs of the Things to remove
+     * @param count The number of UUIDs
+     *
+     * @return The number of Things removed
+    */
+    inline size_t remove_many__unsafe(const Uuid* uuids, size_t count) {
+        uint64_t touched = 0;
+        for (size_t idx = 0; idx < count; idx++) touched |= 1ull << _shard_index(uuids[idx]);
+        std::vector<ThingPtr> removed;
+        removed.reserve(count);
+        {
+            AllShardsLock lock{ touched, _self_locking(), Access::EXCLUSIVE };
+            for (size_t idx = 0; idx < count; idx++) {
+                bool found = false;
+                ThingPtr thing = _unlink__unsafe(_shard_index(uuids[idx]), uuids[idx], &found);
+                if (found) removed.push_back(std::move(thing));
+            }
+        }
+        const size_t removed_count = removed.size();
+        for (auto& thing : removed) _retire(std::move(thing));
+        _reclaim_deferred();
+        return removed_count;
+    }
+
+    /**
+     * @brief Remove many Things from the Codex at once
+     *
+     * Convenience overload, see remove_many__unsafe(const Uuid*, size_t)
+     * This method is not thread safe.
+    */
+    inline size_t remove_many__unsafe(const std::vector<Uuid>& uuids) {
+        return remove_many__unsafe(uuids.data(), uuids.size());
+    }
+
+    /**
+     * @brief Remove many Things from the Codex at once
+     *
+     * Same as remove_many__unsafe(), but the Codex is locked once for the whole batch.
+     * This method is threadsafe.
+     *
+     * @param uuids The UUIDs of the Things to remove
+     * @param count The number of UUIDs
+     *
+     * @return The number of Things removed
+    */
+    inline size_t remove_many(const Uuid* uuids, size_t count) {
+        size_t removed;
+        {
+            // in sharded mode remove_many__unsafe() locks the shards itself
+            AllShardsLock lock{ !kSharded };
+            removed = remove_many__unsafe(uuids, count);
+        }
+        _reclaim_deferred();
+        return removed;
+    }
+
+    /**
+     * @brief Remove many Things from the Codex at once
+     *
+     * Convenience overload, see remove_many(const Uuid*, size_t)
+     * This method is threadsafe.
+    */
+    inline size_t remove_many(const std::vector<Uuid>& uuids) {
+        return remove_many(uuids.data(), uuids.size());
+    }
+
+    /**
+     * @brief Remove a Thing and everything depending on it
+     *
+     * Collects the closure of `dependents_fn` starting at `uuid` with an explicit
+     * worklist, unlinking every Thing as it's reached, and only then runs their
+     * removal hooks (as one batch) and destroys them, one after another. Neither
+     * collecting nor destroying recurses, so very deep (and very wide) dependency
+     * graphs are removed in constant stack space.
+     * Things are unlinked before their dependents are looked at, so cycles and
+     * shared dependents are fine. UUIDs not in the Codex are skipped.
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) all shards get locked while the
+     * closure is collected, except the ones the calling thread already holds.
+     *
+     * @param uuid The UUID of the first Thing to remove
+     * @param dependents_fn Called as `dependents_fn(const Thing*, std::vector<Uuid>&)`,
+     *        appends the UUIDs to be removed along with the Thing. The Thing is
+     *        already unlinked, but still alive
+     *
+     * @return The number of Things removed
+    */
+    template <typename F>
+    size_t remove_cascade__unsafe(const Uuid& uuid, F dependents_fn) {
+        std::vector<ThingPtr> removed;
+        {
+            AllShardsLock lock{ _self_locking() };
+            std::vector<Uuid> worklist{ uuid };
+            while (!worklist.empty()) {
+                const Uuid current = worklist.back();
+                worklist.pop_back();
+                bool found = false;
+                ThingPtr thing = _unlink__unsafe(_shard_index(current), current, &found);
+                if (!found) continue;
+                dependents_fn(static_cast<const Thing*>(thing.get()), worklist);
+                removed.push_back(std::move(thing));
+            }
+        }
+        const size_t count = removed.size();
+        for (auto& thing : removed) _retire(std::move(thing));
+        _reclaim_deferred();
+        return count;
+    }
+
+    /**
+     * @brief Remove a Thing and everything depending on it, see Thing::dependents()
+     *
+     * This method is not thread safe, see remove_cascade__unsafe(const Uuid&, F)
+     *
+     * @param uuid The UUID of the first Thing to remove
+     *
+     * @return The number of Things removed
+    */
+    inline size_t remove_cascade__unsafe(const Uuid& uuid) {
+        return remove_cascade__unsafe(uuid, [](const Thing* thing, std::vector<Uuid>& out) { thing->dependents(out); });
+    }
+
+    /**
+     * @brief Remove a Thing and everything depending on it
+     *
+     * See remove_cascade__unsafe(const Uuid&, F), the Codex stays locked while the
+     * closure is collected and all Things are destroyed after it has been unlocked.
+     * This method is threadsafe.
+     *
+     * @param uuid The UUID of the first Thing to remove
+     * @param dependents_fn Called as `dependents_fn(const Thing*, std::vector<Uuid>&)`,
+     *        appends the UUIDs to be removed along with the Thing
+     *
+     * @return The number of Things removed
+    */
+    template <typename F>
+    size_t remove_cascade(const Uuid& uuid, F dependents_fn) {
+        size_t count;
+        {
+            // in sharded mode remove_cascade__unsafe() locks the shards itself
+            AllShardsLock lock{ !kSharded };
+            count = remove_cascade__unsafe(uuid, dependents_fn);
+        }
+        _reclaim_deferred();
+        return count;
+    }
+
+    /**
+     * @brief Remove a Thing and everything depending on it, see Thing::dependents()
+     *
+     * This method is threadsafe.
+     *
+     * @param uuid The UUID of the first Thing to remove
+     *
+     * @return The number of Things removed
+    */
+    inline size_t remove_cascade(const Uuid& uuid) {
+        return remove_cascade(uuid, [](const Thing* thing, std::vector<Uuid>& out) { thing->dependents(out); });
+    }
+
+    /**
+     * @brief Remove a Thing and everything depending on it, see Thing::dependents()
+     *
+     * This method is threadsafe.
+     *
+     * @param ptr A ptr to the first Thing to remove
+     *
+     * @return The number of Things removed
+    */
+    inline size_t remove_cascade(Thing* ptr) {
+        return remove_cascade(ptr->get_id());
+    }
+
+namespace detail {
+    /**
+     * @brief Number of handle indices in use across all shards, all shard lock holder only
+    */
+    inline size_t _handle_index_count__unsafe() {
+        size_t used = 0;
+        for (size_t shard = 0; shard < kShardCount; shard++) used = std::max<size_t>(used, _get_shards()[shard].slots.used());
+        return used << kShardBits;
+    }
+
+    /**
+     * @brief The UUIDs registered with add_root() (per Codex)
+    */
+    struct Roots {
+        Mutex mutex;
+        FlatMap<bool> uuids;
+    };
+
+    inline Roots* _get_roots();
+
+    /**
+     * @brief Threads shared by the parallel mark of collect() and the parallel traversals (global)
+     *
+     * The threads are started the first time they are needed and then wait for the
+     * next parallel region, so a region costs a wakeup instead of a thread start.
+     * One region runs at a time, the tasks must not start another one.
+    */
+    class WorkerPool {
+    private:
+        std::mutex _region;
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        std::vector<std::thread> _threads;
+        const std::function<void(size_t)>* _task = nullptr;
+        size_t _workers = 0;
+        size_t _running = 0;
+        uint64_t _round = 0;
+        bool _stop = false;
+
+        void _run(size_t worker, uint64_t seen) {
+            std::unique_lock<std::mutex> lock{ this->_mutex };
+            while (true) {
+                this->_wake.wait(lock, [this, seen]() { return this->_stop || this->_round != seen; });
+                if (this->_stop) break;
+                seen = this->_round;
+                if (worker >= this->_workers) continue;
+                const std::function<void(size_t)>* task = this->_task;
+                lock.unlock();
+                (*task)(worker);
+                lock.lock();
+                if (--this->_running == 0) this->_done.notify_all();
+            }
+        }
+
+    public:
+        WorkerPool() = default;
+
+        ~WorkerPool() {
+            {
+                std::lock_guard<std::mutex> lock{ this->_mutex };
+                this->_stop = true;
+            }
+            this->_wake.notify_all();
+            for (auto& thread : this->_threads) thread.join();
+        }
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        /**
+         * @brief Runs `task(worker)` for every worker in [0, workers), worker 0 on the calling thread
+         *
+         * Returns once all of them have returned.
+        */
+        void run(size_t workers, const std::function<void(size_t)>& task) {
+            std::lock_guard<std::mutex> region{ this->_region };
+            {
+                std::lock_guard<std::mutex> lock{ this->_mutex };
+                // new threads join the round started below
+                while (this->_threads.size() + 1 < workers) this->_threads.emplace_back(&WorkerPool::_run, this, this->_threads.size() + 1, this->_round);
+                this->_task = &task;
+                this->_workers = workers;
+                this->_running = workers - 1;
+                this->_round++;
+            }
+            this->_wake.notify_all();
+            task(0);
+            std::unique_lock<std::mutex> lock{ this->_mutex };
+            this->_done.wait(lock, [this]() { return this->_running == 0; });
+        }
+    };
+
+    /**
+     * @brief Getter for the worker pool (global)
+     *
+     * nullptr once it has been shut down at exit, everything runs on the calling thread after that
+    */
+    inline WorkerPool* _get_worker_pool() {
+        // trivially destructible, so it can still be read after the pool is gone
+        static bool exited = false;
+        struct Holder {
+            bool* exited;
+            WorkerPool pool;
+            explicit Holder(bool* exited) : exited(exited) {}
+            ~Holder() { *this->exited = true; }
+        };
+        if (exited) return nullptr;
+        static Holder holder{ &exited };
+        return &holder.pool;
+    }
+
+    /**
+     * @brief How many workers to run with for `threads` (0 picks one per core)
+    */
+    inline size_t _worker_count(size_t threads) {
+        if (threads == 0) threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        return (threads > 1 && _get_worker_pool() != nullptr) ? threads : 1;
+    }
+
+    /**
+     * @brief Runs `task(worker)` for every worker in [0, workers), see WorkerPool::run()
+    */
+    template <typename F>
+    void _run_workers(size_t workers, const F& task) {
+        if (workers <= 1) {
+            task(0);
+            return;
+        }
+        _get_worker_pool()->run(workers, std::function<void(size_t)>(std::cref(task)));
+    }
+
+    /**
+     * @brief One deque per worker, the owner works off the back, idle workers steal from the front
+    */
+    template <typename T>
+    class StealingDeques {
+    private:
+        struct Deque {
+            std::mutex mutex;
+            std::deque<T> items;
+        };
+
+        std::unique_ptr<Deque[]> _deques;
+        const size_t _workers;
+
+    public:
+        explicit StealingDeques(size_t workers) : _deques(new Deque[workers]), _workers(workers) {}
+
+        void push(size_t worker, T item) {
+            std::lock_guard<std::mutex> lock{ this->_deques[worker].mutex };
+            this->_deques[worker].items.push_back(std::move(item));
+        }
+
+        bool pop(size_t worker, T& out) {
+            Deque& deque = this->_deques[worker];
+            std::lock_guard<std::mutex> lock{ deque.mutex };
+            if (deque.items.empty()) return false;
+            out = std::move(deque.items.back());
+            deque.items.pop_back();
+            return true;
+        }
+
+        /**
+         * @brief Takes the oldest item of another worker, trying the next ones first
+        */
+        bool steal(size_t worker, T& out) {
+            for (size_t offset = 1; offset < this->_workers; offset++) {
+                Deque& deque = this->_deques[(worker + offset) % this->_workers];
+                std::lock_guard<std::mutex> lock{ deque.mutex };
+                if (deque.items.empty()) continue;
+                out = std::move(deque.items.front());
+                deque.items.pop_front();
+                return true;
+            }
+            return false;
+        }
+    };
+
+    /**
+     * @brief Marks the Things reported by visit_refs() and pushes the new ones onto its stack
+    */
+    class Marker : public RefVisitor {
+    private:
+        SlotBitmap& _marked;
+        std::vector<Thing*>& _stack;
+
+        void _mark(Thing* thing) {
+            if (thing != nullptr && this->_marked.set(thing->get_handle().index)) this->_stack.push_back(thing);
+        }
+
+    public:
+        Marker(SlotBitmap& marked, std::vector<Thing*>& stack) : _marked(marked), _stack(stack) {}
+
+        void visit(const Uuid& uuid) override {
+            const ThingPtr* entry = _get_shards()[_shard_index(uuid)].mapping.find(uuid);
+            if (entry != nullptr) this->_mark(entry->get());
+        }
+
+        void visit(const Handle<Thing>& handle) override {
+            if (handle.is_null()) return;
+            this->_mark(_get_shards()[_handle_shard(handle.index)].slots.resolve(_handle_slot(handle.index), handle.generation));
+        }
+    };
+
+    /**
+     * @brief Marks everything reachable from `stack`, whose Things are already marked
+     *
+     * The calling thread and `workers - 1` pool workers work off their own stacks.
+     * While some worker is idle, the others push half of their stack onto their
+     * deque for it to steal. Marking is done once every worker is idle. The Codex
+     * is locked by the caller and not modified meanwhile, so the workers read it
+     * without locking.
+    */
+    inline void _mark__unsafe(std::vector<Thing*>& stack, SlotBitmap& marked, size_t workers) {
+        static constexpr size_t kShareThreshold = 64;
+        StealingDeques<std::vector<Thing*>> deques{ workers };
+        deques.push(0, std::move(stack));
+        std::atomic<size_t> idle{ 0 };
+        // workers look up references in the caller's Codex, not their thread's default
+        CodexData* codex = _codex();
+        auto work = [&deques, &marked, &idle, workers, codex](size_t worker) {
+            CodexScope scope{ codex };
+            std::vector<Thing*> local;
+            Marker marker{ marked, local };
+            while (true) {
+                if (!deques.pop(worker, local)) {
+                    // counted as busy while stealing, so idle == workers means no work is left anywhere
+                    bool stolen = deques.steal(worker, local);
+                    if (!stolen) idle++;
+                    while (!stolen) {
+                        if (idle.load() == workers) return;
+                        std::this_thread::yield();
+                        idle--;
+                        stolen = deques.steal(worker, local);
+                        if (!stolen) idle++;
+                    }
+                }
+                while (!local.empty()) {
+                    const Thing* thing = local.back();
+                    local.pop_back();
+                    thing->visit_refs(marker);
+                    if (local.size() >= kShareThreshold && idle.load(std::memory_order_relaxed) > 0) {
+                        const size_t half = local.size() / 2;
+                        deques.push(worker, std::vector<Thing*>(local.begin(), local.begin() + half));
+                        local.erase(local.begin(), local.begin() + half);
+                    }
+                }
+            }
+        };
+        _run_workers(workers, work);
+    }
+};
+
+    /**
+     * @brief Registers a root for collect()
+     *
+     * Everything reachable from a root through Thing::visit_refs() survives collect().
+     * Roots are forgotten once their Thing has been removed from the Codex.
+     * This method is threadsafe.
+     *
+     * @param uuid The UUID of the root
+    */
+    inline void add_root(const Uuid& uuid) {
+        Roots* roots = _get_roots();
+        std::lock_guard<Mutex> lock{ roots->mutex };
+        roots->uuids[uuid] = true;
+        // a running collect_incremental() has looked at the roots already
+        _gc_shade(uuid);
+    }
+
+    /**
+     * @brief Registers a root for collect()
+     *
+     * Convenience overload, see add_root(const Uuid&)
+     * This method is threadsafe.
+    */
+    inline void add_root(const Thing* thing) {
+        add_root(thing->get_id());
+    }
+
+    /**
+     * @brief Unregisters a root, its Things are collected by the next collect() unless reachable otherwise
+     *
+     * This method is threadsafe.
+     *
+     * @param uuid The UUID of the root
+     *
+     * @return Status::SUCCESS or Status::Failure (if the UUID isn't a root)
+    */
+    inline Status remove_root(const Uuid& uuid) {
+        Roots* roots = _get_roots();
+        std::lock_guard<Mutex> lock{ roots->mutex };
+        return roots->uuids.erase(uuid) ? Status::SUCCESS : Status::FAILURE;
+    }
+
+    /**
+     * @brief Unregisters a root
+     *
+     * Convenience overload, see remove_root(const Uuid&)
+     * This method is threadsafe.
+    */
+    inline Status remove_root(const Thing* thing) {
+        return remove_root(thing->get_id());
+    }
+
+    /**
+     * @brief Removes every Thing that can't be reached from the roots, see add_root()
+     *
+     * Mark and sweep: everything reachable from the roots through Thing::visit_refs()
+     * is marked in a bitmap indexed by Handle, in parallel, then all unmarked Things
+     * are unlinked in one pass. Their removal hooks see them as one batch and they
+     * are destroyed after the Codex has been unlocked, see Thing::on_remove_batch().
+     * Cycles that aren't reachable from a root are collected as well.
+     * Things that don't override visit_refs() keep nothing alive, so only call
+     * this once every Thing that's referenced reports its references.
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) all shards get locked, except the
+     * ones the calling thread already holds.
+     *
+     * @param threads The number of threads marking, 0 picks one per core. Small
+     *        Codices are always marked on the calling thread only
+     *
+     * @return The number of Things removed
+    */
+    inline size_t collect__unsafe(size_t threads = 0) {
+        static constexpr size_t kParallelThreshold = 16384;
+        std::vector<ThingPtr> garbage;
+        {
+            AllShardsLock lock{ _self_locking() };
+            Shard* shards = _get_shards();
+            SlotBitmap marked{ _handle_index_count__unsafe() };
+            std::vector<Thing*> stack;
+            {
+                Roots* roots = _get_roots();
+                std::lock_guard<Mutex> roots_lock{ roots->mutex };
+                std::vector<Uuid> gone;
+                for (const auto& root : roots->uuids) {
+                    const ThingPtr* entry = shards[_shard_index(root.key)].mapping.find(root.key);
+                    if (entry == nullptr) gone.push_back(root.key);
+                    else if (marked.set((*entry)->get_handle().index)) stack.push_back(entry->get());
+                }
+                for (const auto& uuid : gone) roots->uuids.erase(uuid);
+            }
+
+            size_t count = 0;
+            for (size_t shard = 0; shard < kShardCount; shard++) count += shards[shard].mapping.size();
+            _mark__unsafe(stack, marked, (count < kParallelThreshold) ? 1 : _worker_count(threads));
+
+            std::vector<Uuid> unreachable;
+            for (size_t shard = 0; shard < kShardCount; shard++) {
+                unreachable.clear();
+                for (const auto& slot : shards[shard].mapping) {
+                    if (!marked.test(slot.value->get_handle().index)) unreachable.push_back(slot.key);
+                }
+                for (const auto& uuid : unreachable) {
+                    bool found = false;
+                    garbage.push_back(_unlink__unsafe(shard, uuid, &found));
+                }
+            }
+        }
+        const size_t count = garbage.size();
+        for (auto& thing : garbage) _retire(std::move(thing));
+        _reclaim_deferred();
+        return count;
+    }
+
+    /**
+     * @brief Removes every Thing that can't be reached from the roots, see add_root()
+     *
+     * See collect__unsafe(), the Codex stays locked while marking and sweeping and
+     * all unreachable Things are destroyed after it has been unlocked.
+     * This method is threadsafe.
+     *
+     * @param threads The number of threads marking, 0 picks one per core
+     *
+     * @return The number of Things removed
+    */
+    inline size_t collect(size_t threads = 0) {
+        size_t count;
+        {
+            // in sharded mode collect__unsafe() locks the shards itself
+            AllShardsLock lock{ !kSharded };
+            count = collect__unsafe(threads);
+        }
+        _reclaim_deferred();
+        return count;
+    }
+
+    /**
+     * @brief Records that `from` references `to`
+     *
+     * The Codex keeps an index of these links in both directions. Once `to` is
+     * removed, the link is dropped and `from` is told through
+     * Thing::on_referent_removed(), without anything having to be searched. Links
+     * from a removed Thing are dropped as well. Both are done after the removed
+     * Thing's on_remove() hooks ran.
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) the shards of both UUIDs get locked,
+     * unless the calling thread already holds them.
+     *
+     * @param from The UUID of the referencing Thing
+     * @param to The UUID of the referenced Thing
+     *
+     * @return Status::SUCCESS or Status::Failure (if either UUID is not in the Codex)
+    */
+    inline Status link__unsafe(const Uuid& from, const Uuid& to) {
+        const size_t from_shard = _shard_index(from);
+        const size_t to_shard = _shard_index(to);
+        AllShardsLock lock{ (1ull << from_shard) | (1ull << to_shard), _self_locking(), Access::EXCLUSIVE };
+        Shard* shards = _get_shards();
+        ThingPtr* from_entry = shards[from_shard].mapping.find(from);
+        ThingPtr* to_entry = shards[to_shard].mapping.find(to);
+        if (from_entry == nullptr || to_entry == nullptr) return Status::FAILURE;
+        ThingAccess::set_linked(from_entry->get());
+        ThingAccess::set_linked(to_entry->get());
+        if (shards[from_shard].referents[from].insert(to)) shards[to_shard].referrers[to].insert(from);
+        return Status::SUCCESS;
+    }
+
+    /**
+     * @brief Records that `from` references `to`
+     *
+     * See link__unsafe(const Uuid&, const Uuid&)
+     * This method is threadsafe.
+     *
+     * @param from The UUID of the referencing Thing
+     * @param to The UUID of the referenced Thing
+     *
+     * @return Status::SUCCESS or Status::Failure (if either UUID is not in the Codex)
+    */
+    inline Status link(const Uuid& from, const Uuid& to) {
+        // in sharded mode link__unsafe() locks the shards itself
+        ShardLock lock{ 0, !kSharded };
+        return link__unsafe(from, to);
+    }
+
+    /**
+     * @brief Records that `from` references `to`
+     *
+     * Convenience overload, see link(const Uuid&, const Uuid&)
+     * This method is threadsafe.
+    */
+    inline Status link(const Thing* from, const Thing* to) {
+        return link(from->get_id(), to->get_id());
+    }
+
+    /**
+     * @brief Drops a link recorded by link()
+     *
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) the shards of both UUIDs get locked,
+     * unless the calling thread already holds them.
+     *
+     * @param from The UUID of the referencing Thing
+     * @param to The UUID of the referenced Thing
+     *
+     * @return Status::SUCCESS or Status::Failure (if there is no such link)
+    */
+    inline Status unlink__unsafe(const Uuid& from, const Uuid& to) {
+        const size_t from_shard = _shard_index(from);
+        const size_t to_shard = _shard_index(to);
+        AllShardsLock lock{ (1ull << from_shard) | (1ull << to_shard), _self_locking(), Access::EXCLUSIVE };
+        Shard* shards = _get_shards();
+        UuidSet* referents = shards[from_shard].referents.find(from);
+        if (referents == nullptr || !referents->erase(to)) return Status::FAILURE;
+        if (referents->empty()) shards[from_shard].referents.erase(from);
+        UuidSet* referrers = shards[to_shard].referrers.find(to);
+        if (referrers != nullptr && referrers->erase(from) && referrers->empty()) shards[to_shard].referrers.erase(to);
+        return Status::SUCCESS;
+    }
+
+    /**
+     * @brief Drops a link recorded by link()
+     *
+     * This method is threadsafe.
+     *
+     * @param from The UUID of the referencing Thing
+     * @param to The UUID of the referenced Thing
+     *
+     * @return Status::SUCCESS or Status::Failure (if there is no such link)
+    */
+    inline Status unlink(const Uuid& from, const Uuid& to) {
+        // in sharded mode unlink__unsafe() locks the shards itself
+        ShardLock lock{ 0, !kSharded };
+        return unlink__unsafe(from, to);
+    }
+
+    /**
+     * @brief Drops a link recorded by link()
+     *
+     * Convenience overload, see unlink(const Uuid&, const Uuid&)
+     * This method is threadsafe.
+    */
+    inline Status unlink(const Thing* from, const Thing* to) {
+        return unlink(from->get_id(), to->get_id());
+    }
+
+    /**
+     * @brief The UUIDs of all Things linking to `uuid`, see link()
+     *
+     * This method is threadsafe.
+     *
+     * @param uuid The UUID of the referenced Thing
+     *
+     * @return The UUIDs, in no particular order
+    */
+    inline std::vector<Uuid> referrers(const Uuid& uuid) {
+        const size_t shard = _shard_index(uuid);
+        ShardLock lock{ shard, true, Access::SHARED };
+        std::vector<Uuid> result;
+        const UuidSet* set = _get_shards()[shard].referrers.find(uuid);
+        if (set == nullptr) return result;
+        result.reserve(set->size());
+        set->for_each([&result](const Uuid& referrer) { result.push_back(referrer); });
+        return result;
+    }
+
+    /**
+     * @brief The UUIDs of all Things `uuid` links to, see link()
+     *
+     * This method is threadsafe.
+     *
+     * @param uuid The UUID of the referencing Thing
+     *
+     * @return The UUIDs, in no particular order
+    */
+    inline std::vector<Uuid> referents(const Uuid& uuid) {
+        const size_t shard = _shard_index(uuid);
+        ShardLock lock{ shard, true, Access::SHARED };
+        std::vector<Uuid> result;
+        const UuidSet* set = _get_shards()[shard].referents.find(uuid);
+        if (set == nullptr) return result;
+        result.reserve(set->size());
+        set->for_each([&result](const Uuid& referent) { result.push_back(referent); });
+        return result;
+    }
+
+    /**
+     * @brief Looks up the relation with the given name, creating it on first use
+     *
+     * Relations are Codex managed many-to-many relationships, eg "children" or
+     * "depends_on". Instead of every Thing keeping its own vector of UUIDs, the
+     * neighbors of each Thing are stored back to back in one pool per relation and
+     * direction, see neighbors(). Keep the Relation around, looking it up by name
+     * takes a lock. At most 256 relations can be created.
+     * A relation is always locked before the shards of the Codex, so it's fine to
+     * get() the neighbors while holding on to neighbors(). In turn, don't call any
+     * of the relation functions while holding shards of the same Codex yourself,
+     * eg from within a Session.
+     * This method is threadsafe.
+     *
+     * @param name The name of the relation
+     *
+     * @return The Relation
+    */
+    inline Relation relation(const std::string& name) {
+        Relations* relations = _get_relations();
+        std::lock_guard<Mutex> lock{ relations->mutex };
+        const uint32_t count = relations->count.load(std::memory_order_relaxed);
+        for (uint32_t id = 0; id < count; id++) {
+            if (relations->stores[id].load(std::memory_order_relaxed)->name == name) return Relation(id);
+        }
+        if (count == Relations::kMaxRelations) throw std::length_error("dhCodex: too many relations");
+        RelationStore* store = new RelationStore();
+        store->name = name;
+        relations->stores[count].store(store, std::memory_order_release);
+        relations->count.store(count + 1, std::memory_order_release);
+        return Relation(count);
+    }
+
+namespace detail {
+    /**
+     * @brief Adds an edge to a relation the calling thread has locked exclusively
+     *
+     * @param lock_shards Whether to lock the shards of both UUIDs (the ones the
+     *        calling thread doesn't hold already)
+    */
+    inline Status _relate__unsafe(RelationStore* store, const Uuid& from, const Uuid& to, bool lock_shards) {
+        const size_t from_shard = _shard_index(from);
+        const size_t to_shard = _shard_index(to);
+        AllShardsLock lock{ (1ull << from_shard) | (1ull << to_shard), lock_shards, Access::SHARED };
+        Shard* shards = _get_shards();
+        ThingPtr* from_entry = shards[from_shard].mapping.find(from);
+        ThingPtr* to_entry = shards[to_shard].mapping.find(to);
+        if (from_entry == nullptr || to_entry == nullptr) return Status::FAILURE;
+        // both Things stay in the Codex while their shards are locked, so their
+        // removal can only drop the edge after it has been added
+        ThingAccess::set_linked(from_entry->get());
+        ThingAccess::set_linked(to_entry->get());
+        store->out.append(from, to);
+        store->in.append(to, from);
+        return Status::SUCCESS;
+    }
+};
+
+    /**
+     * @brief Adds an edge from `from` to `to` to a relation
+     *
+     * Edges keep the order they were added in. Adding the same edge twice stores it
+     * twice. Once either Thing is removed from the Codex, its edges are dropped.
+     * Modifying a relation invalidates the Spans returned by neighbors__unsafe().
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * The relation gets locked, and in sharded mode (DH_CODEX_SHARDS > 1) so do the
+     * shards of both UUIDs, unless the calling thread already holds them.
+     *
+     * @param from The UUID of the Thing the edge starts at
+     * @param to The UUID of the Thing the edge points to
+     * @param relation The relation, see relation()
+     *
+     * @return Status::SUCCESS or Status::Failure (if either UUID is not in the Codex)
+    */
+    inline Status relate__unsafe(const Uuid& from, const Uuid& to, const Relation& relation) {
+        RelationStore* store = _relation_store(relation);
+        std::lock_guard<RelationMutex> relation_lock{ store->mutex };
+        return _relate__unsafe(store, from, to, _self_locking());
+    }
+
+    /**
+     * @brief Adds an edge from `from` to `to` to a relation
+     *
+     * See relate__unsafe(const Uuid&, const Uuid&, const Relation&)
+     * This method is threadsafe.
+     *
+     * @param from The UUID of the Thing the edge starts at
+     * @param to The UUID of the Thing the edge points to
+     * @param relation The relation, see relation()
+     *
+     * @return Status::SUCCESS or Status::Failure (if either UUID is not in the Codex)
+    */
+    inline Status relate(const Uuid& from, const Uuid& to, const Relation& relation) {
+        // the relation is locked before the shards, see relation()
+        RelationStore* store = _relation_store(relation);
+        std::lock_guard<RelationMutex> relation_lock{ store->mutex };
+        return _relate__unsafe(store, from, to, true);
+    }
+
+    /**
+     * @brief Adds an edge from `from` to `to` to a relation
      *
-     * This function takes a unique_ptr to an instance of Thing (or a subclass) and
-     * adds it to the Codex. The Codex assumes ownership going forward
+     * Convenience overload, see relate(const Uuid&, const Uuid&, const Relation&)
      * This method is threadsafe.
+    */
+    inline Status relate(const Thing* from, const Thing* to, const Relation& relation) {
+        return relate(from->get_id(), to->get_id(), relation);
+    }
+
+    /**
+     * @brief Removes an edge added by relate(), the first one if it was added several times
      *
-     * @tparam T The type of the object to be added. Must be a subclass of Thing
+     * Only locks the relation, not the Codex.
+     * This method is threadsafe.
      *
-     * @param ptr The unique ptr owning the object to be added
+     * @param from The UUID of the Thing the edge starts at
+     * @param to The UUID of the Thing the edge points to
+     * @param relation The relation, see relation()
      *
-     * @return A raw pointer to the object
+     * @return Status::SUCCESS or Status::Failure (if there is no such edge)
     */
-    template<typename T>
-    T* add(std::unique_ptr<T> ptr) {
-        std::lock_guard<std::mutex> lock{ *_get_mutex() };
-        return add__unsafe<T>(std::move(ptr));
+    inline Status unrelate(const Uuid& from, const Uuid& to, const Relation& relation) {
+        RelationStore* store = _relation_store(relation);
+        std::lock_guard<RelationMutex> lock{ store->mutex };
+        if (!store->out.erase(from, to)) return Status::FAILURE;
+        store->in.erase(to, from);
+        return Status::SUCCESS;
     }
 
-    // Base object for Codex
-    class Thing {
+    /**
+     * @brief Removes an edge added by relate()
+     *
+     * Convenience overload, see unrelate(const Uuid&, const Uuid&, const Relation&)
+     * This method is threadsafe.
+    */
+    inline Status unrelate(const Thing* from, const Thing* to, const Relation& relation) {
+        return unrelate(from->get_id(), to->get_id(), relation);
+    }
+
+    /**
+     * @brief The UUIDs `uuid` has edges to, in the order they were added
+     *
+     * The Span points into the relation's storage, so walking it is a sequential
+     * read. It's invalidated by the next modification of the relation, including
+     * the removal of any related Thing.
+     * This method is not thread safe and you could potentially run into
+     * issues if the relation is modified while this method is running on
+     * another thread, or while the Span is in use.
+     *
+     * @param uuid The UUID of the Thing the edges start at
+     * @param relation The relation, see relation()
+     *
+     * @return The UUIDs
+    */
+    inline Span<Uuid> neighbors__unsafe(const Uuid& uuid, const Relation& relation) {
+        return _relation_store(relation)->out.get(uuid);
+    }
+
+    /**
+     * @brief The UUIDs that have edges to `uuid`, in the order they were added
+     *
+     * Same as neighbors__unsafe(), in the other direction.
+     * This method is not thread safe.
+    */
+    inline Span<Uuid> inverse_neighbors__unsafe(const Uuid& uuid, const Relation& relation) {
+        return _relation_store(relation)->in.get(uuid);
+    }
+
+    /**
+     * @brief Span over the neighbors of a Thing that keeps the relation read locked
+     *
+     * Returned by neighbors(). Other threads can't modify the relation while it's
+     * alive, so don't modify the relation from the same thread either. Looking the
+     * neighbors up with get() is fine, see relation(). Can be nested, eg to walk
+     * the neighbors of the neighbors, but has to be destroyed on the thread that
+     * created it.
+    */
+    class Neighbors : public Span<Uuid> {
+    private:
+        CodexState* _codex;
+        Relation _relation;
+        bool _locked;
+
+    public:
+        Neighbors(const Relation& relation, Span<Uuid> span) : Span<Uuid>(span), _codex(_codex_state()), _relation(relation), _locked(true) {}
+        Neighbors(Neighbors&& other) : Span<Uuid>(other), _codex(other._codex), _relation(other._relation), _locked(other._locked) { other._locked = false; }
+        ~Neighbors() {
+            // might be destroyed after the Codex it came from stopped being the current one
+            CodexScope scope{ _codex_data(this->_codex) };
+            if (this->_locked) _unlock_relation_shared(_relation_store(this->_relation));
+        }
+        Neighbors(const Neighbors&) = delete;
+        Neighbors& operator=(const Neighbors&) = delete;
+    };
+
+    /**
+     * @brief The UUIDs `uuid` has edges to, in the order they were added
+     *
+     * Same as neighbors__unsafe(), but the relation stays read locked for as long as
+     * the returned object is alive.
+     * This method is threadsafe.
+     *
+     * @param uuid The UUID of the Thing the edges start at
+     * @param relation The relation, see relation()
+     *
+     * @return The UUIDs
+    */
+    inline Neighbors neighbors(const Uuid& uuid, const Relation& relation) {
+        _lock_relation_shared(_relation_store(relation));
+        return Neighbors(relation, _relation_store(relation)->out.get(uuid));
+    }
+
+    /**
+     * @brief The UUIDs that have edges to `uuid`, in the order they were added
+     *
+     * Same as neighbors(), in the other direction.
+     * This method is threadsafe.
+    */
+    inline Neighbors inverse_neighbors(const Uuid& uuid, const Relation& relation) {
+        _lock_relation_shared(_relation_store(relation));
+        return Neighbors(relation, _relation_store(relation)->in.get(uuid));
+    }
+
+namespace detail {
+    /**
+     * @brief Collects the edges reported by a traversal's edge function
+     *
+     * Handles are resolved right away, UUIDs are looked up all at once by resolve().
+     * Either way the edges keep the order they were reported in.
+    */
+    class EdgeBatch : public RefVisitor {
     private:
-        const std::string _uuid;
+        std::vector<Thing*> _things;
+        std::vector<Uuid> _uuids;
+        std::vector<size_t> _positions;
+        std::vector<Thing*> _found;
 
     public:
+        void visit(const Uuid& uuid) override {
+            this->_positions.push_back(this->_things.size());
+            this->_uuids.push_back(uuid);
+            this->_things.push_back(nullptr);
+        }
+
+        void visit(const Handle<Thing>& handle) override {
+            if (handle.is_null()) return;
+            this->_things.push_back(_get_shards()[_handle_shard(handle.index)].slots.resolve(_handle_slot(handle.index), handle.generation));
+        }
+
         /**
-         * @brief create() becomes the defacto 'constructor' to be used to create Thing objects
+         * @brief Looks up the UUIDs reported so far, the Codex is locked by the caller
          *
-         * While this could be implemented however one likes, the important part is that after creating
-         * a unique ptr, it needs to get passed to add() for the codex to take ownership. This cant be
-         * part of the constructor as there is no clean way to turn `this` into a unique_ptr.
-         * Personally I like `create()` as it can mimic the signature of the actual constructor and just
-         * pass along the arguments.
+         * @return The Things, nullptr for stale Handles and UUIDs not in the Codex
         */
-        static Thing* create() {
-            return add(std::make_unique<Thing>());
+        const std::vector<Thing*>& resolve() {
+            this->_found.resize(this->_uuids.size());
+            _find_many_by_uuid__unsafe<Thing>(this->_uuids.data(), this->_uuids.size(), this->_found.data());
+            for (size_t idx = 0; idx < this->_positions.size(); idx++) this->_things[this->_positions[idx]] = this->_found[idx];
+            return this->_things;
+        }
+
+        void clear() {
+            this->_things.clear();
+            this->_uuids.clear();
+            this->_positions.clear();
+        }
+    };
+
+    /**
+     * @brief Edge function following a relation, the caller holds the relation's read lock
+    */
+    struct RelationEdges {
+        const Adjacency* adjacency;
+
+        void operator()(const Thing* thing, RefVisitor& visitor) const {
+            for (const Uuid& uuid : this->adjacency->get(thing->get_id())) visitor.visit(uuid);
+        }
+    };
+
+    /**
+     * @brief RAII read lock for a relation, see _lock_relation_shared()
+    */
+    class RelationReadLock {
+    private:
+        RelationStore* _store;
+
+    public:
+        explicit RelationReadLock(const Relation& relation) : _store(_relation_store(relation)) { _lock_relation_shared(this->_store); }
+        ~RelationReadLock() { _unlock_relation_shared(this->_store); }
+        RelationReadLock(const RelationReadLock&) = delete;
+        RelationReadLock& operator=(const RelationReadLock&) = delete;
+    };
+
+    inline std::vector<Uuid> _uuids_of(const std::vector<Thing*>& things) {
+        std::vector<Uuid> uuids;
+        uuids.reserve(things.size());
+        for (const Thing* thing : things) uuids.push_back(thing->get_id());
+        return uuids;
+    }
+
+    /**
+     * @brief Appends the Things `count` Things starting at `frontier` have edges to and that haven't been visited yet
+    */
+    template <typename F>
+    void _expand__unsafe(Thing* const* frontier, size_t count, const F& edges, SlotBitmap& visited, EdgeBatch& batch, std::vector<Thing*>& next) {
+        batch.clear();
+        for (size_t idx = 0; idx < count; idx++) edges(static_cast<const Thing*>(frontier[idx]), static_cast<RefVisitor&>(batch));
+        for (Thing* thing : batch.resolve()) {
+            if (thing != nullptr && visited.set(thing->get_handle().index)) next.push_back(thing);
+        }
+    }
+
+    /**
+     * @brief Breadth first traversal, see bfs()
+     *
+     * Level synchronous: every level is cut into chunks which are dealt out to the
+     * deques of the calling thread and its pool workers, idle workers steal from the
+     * others. Each chunk's edges are looked up as one batch. The next level is put
+     * together in chunk order. The Codex is locked by
+     * the caller and not modified meanwhile, so the helpers read it without locking.
+     *
+     * @param max_depth Levels below the root to visit
+     * @param include_root Whether the root counts as visited from the start,
+     *        otherwise it's only visited if it can be reached from itself
+     *
+     * @return The visited Things, level by level
+    */
+    template <typename F>
+    std::vector<Thing*> _bfs__unsafe(const Uuid& root, const F& edges, size_t max_depth, size_t threads, bool include_root) {
+        static constexpr size_t kChunk = 256;
+        static constexpr size_t kParallelThreshold = 4096;
+        std::vector<Thing*> result;
+        Thing* start = _find_one_by_uuid__unsafe<Thing>(root);
+        if (start == nullptr) return result;
+        SlotBitmap visited{ _handle_index_count__unsafe() };
+        if (include_root) {
+            visited.set(start->get_handle().index);
+            result.push_back(start);
+        }
+
+        const size_t workers = _worker_count(threads);
+        std::vector<EdgeBatch> batches(workers);
+        std::vector<std::vector<Thing*>> parts;
+        std::vector<Thing*> frontier{ start };
+        // helpers resolve edges in the caller's Codex, not their thread's default
+        CodexData* codex = _codex();
+        for (size_t depth = 0; depth < max_depth && !frontier.empty(); depth++) {
+            const size_t chunks = (frontier.size() + kChunk - 1) / kChunk;
+            parts.resize(chunks);
+            for (auto& part : parts) part.clear();
+            const size_t active = (frontier.size() < kParallelThreshold) ? 1 : std::min(workers, chunks);
+            StealingDeques<size_t> deques{ active };
+            for (size_t chunk = 0; chunk < chunks; chunk++) deques.push(chunk % active, chunk);
+            auto work = [&](size_t worker) {
+                CodexScope scope{ codex };
+                size_t chunk;
+                while (deques.pop(worker, chunk) || deques.steal(worker, chunk)) {
+                    const size_t begin = chunk * kChunk;
+                    _expand__unsafe(frontier.data() + begin, std::min(kChunk, frontier.size() - begin), edges, visited, batches[worker], parts[chunk]);
+                }
+            };
+            _run_workers(active, work);
+
+            frontier.clear();
+            for (const auto& part : parts) frontier.insert(frontier.end(), part.begin(), part.end());
+            result.insert(result.end(), frontier.begin(), frontier.end());
+        }
+        return result;
+    }
+
+    /**
+     * @brief Depth first traversal in pre-order, see dfs()
+    */
+    template <typename F>
+    std::vector<Thing*> _dfs__unsafe(const Uuid& root, const F& edges) {
+        std::vector<Thing*> result;
+        Thing* start = _find_one_by_uuid__unsafe<Thing>(root);
+        if (start == nullptr) return result;
+        SlotBitmap visited{ _handle_index_count__unsafe() };
+        EdgeBatch batch;
+        std::vector<Thing*> stack{ start };
+        while (!stack.empty()) {
+            Thing* thing = stack.back();
+            stack.pop_back();
+            // a Thing can be on the stack several times, only its first visit counts
+            if (!visited.set(thing->get_handle().index)) continue;
+            result.push_back(thing);
+            batch.clear();
+            edges(static_cast<const Thing*>(thing), static_cast<RefVisitor&>(batch));
+            const std::vector<Thing*>& next = batch.resolve();
+            for (size_t idx = next.size(); idx-- > 0;) {
+                if (next[idx] != nullptr && !visited.test(next[idx]->get_handle().index)) stack.push_back(next[idx]);
+            }
+        }
+        return result;
+    }
+};
+
+    /**
+     * @brief Breadth first traversal of the Things reachable from `root`
+     *
+     * `edges` is called as `edges(const Thing*, RefVisitor&)` for every Thing visited
+     * and reports the Thing's outgoing edges to the visitor, by UUID or by Handle (eg
+     * through Thing::visit_refs()). Levels are expanded in parallel, the edges are
+     * looked up in batches and visited Things are tracked in a bitmap indexed by
+     * Handle, so a Thing is only visited once. `edges` may be called from several
+     * threads at once while the Codex is locked, so only read the Thing from it,
+     * don't call into the Codex.
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) all shards get locked, except the
+     * ones the calling thread already holds.
+     *
+     * @tparam F The edge function
+     *
+     * @param root The UUID of the Thing to start from
+     * @param edges Reports the edges of a Thing
+     * @param threads The number of threads, 0 picks one per core. Levels with
+     *        less than 4096 Things are expanded on the calling thread only
+     *
+     * @return `root` followed by the UUIDs of the Things reachable from it, level by
+     *         level. With more than one thread the order within a level can vary.
+     *         Empty if `root` is not in the Codex
+    */
+    template <typename F>
+    std::vector<Uuid> bfs__unsafe(const Uuid& root, const F& edges, size_t threads = 0) {
+        AllShardsLock lock{ _self_locking(), Access::SHARED };
+        return _uuids_of(_bfs__unsafe(root, edges, SIZE_MAX, threads, true));
+    }
+
+    /**
+     * @brief Breadth first traversal of the Things reachable from `root`
+     *
+     * See bfs__unsafe(), the Codex stays locked for the whole traversal.
+     * This method is threadsafe.
+    */
+    template <typename F>
+    std::vector<Uuid> bfs(const Uuid& root, const F& edges, size_t threads = 0) {
+        // in sharded mode bfs__unsafe() locks the shards itself
+        AllShardsLock lock{ !kSharded, Access::SHARED };
+        return bfs__unsafe(root, edges, threads);
+    }
+
+    /**
+     * @brief Breadth first traversal along the edges of a relation
+     *
+     * Convenience overload, see bfs__unsafe(). The relation stays read locked for the
+     * whole traversal.
+     * This method is threadsafe.
+    */
+    inline std::vector<Uuid> bfs(const Uuid& root, const Relation& relation, size_t threads = 0) {
+        RelationReadLock relation_lock{ relation };
+        AllShardsLock lock{ true, Access::SHARED };
+        return bfs__unsafe(root, RelationEdges{ &_relation_store(relation)->out }, threads);
+    }
+
+    /**
+     * @brief Depth first traversal of the Things reachable from `root`
+     *
+     * Same as bfs__unsafe(), but the Things come in pre-order: every Thing is
+     * followed by everything reachable from its first edge, then its second edge
+     * and so on. Runs on the calling thread only, the edges of every Thing are
+     * looked up as one batch.
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) all shards get locked, except the
+     * ones the calling thread already holds.
+     *
+     * @tparam F The edge function, see bfs__unsafe()
+     *
+     * @param root The UUID of the Thing to start from
+     * @param edges Reports the edges of a Thing
+     *
+     * @return `root` followed by the UUIDs of the Things reachable from it. Empty if
+     *         `root` is not in the Codex
+    */
+    template <typename F>
+    std::vector<Uuid> dfs__unsafe(const Uuid& root, const F& edges) {
+        AllShardsLock lock{ _self_locking(), Access::SHARED };
+        return _uuids_of(_dfs__unsafe(root, edges));
+    }
+
+    /**
+     * @brief Depth first traversal of the Things reachable from `root`
+     *
+     * See dfs__unsafe(), the Codex stays locked for the whole traversal.
+     * This method is threadsafe.
+    */
+    template <typename F>
+    std::vector<Uuid> dfs(const Uuid& root, const F& edges) {
+        // in sharded mode dfs__unsafe() locks the shards itself
+        AllShardsLock lock{ !kSharded, Access::SHARED };
+        return dfs__unsafe(root, edges);
+    }
+
+    /**
+     * @brief Depth first traversal along the edges of a relation
+     *
+     * Convenience overload, see dfs__unsafe(). The relation stays read locked for the
+     * whole traversal.
+     * This method is threadsafe.
+    */
+    inline std::vector<Uuid> dfs(const Uuid& root, const Relation& relation) {
+        RelationReadLock relation_lock{ relation };
+        AllShardsLock lock{ true, Access::SHARED };
+        return dfs__unsafe(root, RelationEdges{ &_relation_store(relation)->out });
+    }
+
+    /**
+     * @brief All Things that can be reached from `root` through at least one edge
+     *
+     * The transitive closure of `root`: same as bfs__unsafe(), except that `root`
+     * itself is only part of the result if it's on a cycle. Use this when the order
+     * doesn't matter.
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) all shards get locked, except the
+     * ones the calling thread already holds.
+     *
+     * @tparam F The edge function, see bfs__unsafe()
+     *
+     * @param root The UUID of the Thing to start from
+     * @param edges Reports the edges of a Thing
+     * @param threads The number of threads, 0 picks one per core
+     *
+     * @return The UUIDs, in no particular order
+    */
+    template <typename F>
+    std::vector<Uuid> reachable_from__unsafe(const Uuid& root, const F& edges, size_t threads = 0) {
+        AllShardsLock lock{ _self_locking(), Access::SHARED };
+        return _uuids_of(_bfs__unsafe(root, edges, SIZE_MAX, threads, false));
+    }
+
+    /**
+     * @brief All Things that can be reached from `root` through at least one edge
+     *
+     * See reachable_from__unsafe(), the Codex stays locked for the whole traversal.
+     * This method is threadsafe.
+    */
+    template <typename F>
+    std::vector<Uuid> reachable_from(const Uuid& root, const F& edges, size_t threads = 0) {
+        // in sharded mode reachable_from__unsafe() locks the shards itself
+        AllShardsLock lock{ !kSharded, Access::SHARED };
+        return reachable_from__unsafe(root, edges, threads);
+    }
+
+    /**
+     * @brief All Things that can be reached from `root` along the edges of a relation
+     *
+     * Convenience overload, see reachable_from__unsafe(). The relation stays read
+     * locked for the whole traversal.
+     * This method is threadsafe.
+    */
+    inline std::vector<Uuid> reachable_from(const Uuid& root, const Relation& relation, size_t threads = 0) {
+        RelationReadLock relation_lock{ relation };
+        AllShardsLock lock{ true, Access::SHARED };
+        return reachable_from__unsafe(root, RelationEdges{ &_relation_store(relation)->out }, threads);
+    }
+
+    /**
+     * @brief `root` and the Things at most `depth` edges below it, eg a part of a hierarchy
+     *
+     * Same as bfs__unsafe(), but stops after `depth` levels. Every Thing comes after
+     * the Thing it was reached from.
+     * This method is not thread safe and you could potentially run into
+     * issues if the codex is modified while this method is running on
+     * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) all shards get locked, except the
+     * ones the calling thread already holds.
+     *
+     * @tparam F The edge function, see bfs__unsafe()
+     *
+     * @param root The UUID of the Thing to start from
+     * @param edges Reports the edges of a Thing
+     * @param depth The number of levels below `root`, 0 only returns `root`
+     * @param threads The number of threads, 0 picks one per core
+     *
+     * @return The UUIDs level by level, empty if `root` is not in the Codex
+    */
+    template <typename F>
+    std::vector<Uuid> subtree__unsafe(const Uuid& root, const F& edges, size_t depth, size_t threads = 0) {
+        AllShardsLock lock{ _self_locking(), Access::SHARED };
+        return _uuids_of(_bfs__unsafe(root, edges, depth, threads, true));
+    }
+
+    /**
+     * @brief `root` and the Things at most `depth` edges below it
+     *
+     * See subtree__unsafe(), the Codex stays locked for the whole traversal.
+     * This method is threadsafe.
+    */
+    template <typename F>
+    std::vector<Uuid> subtree(const Uuid& root, const F& edges, size_t depth, size_t threads = 0) {
+        // in sharded mode subtree__unsafe() locks the shards itself
+        AllShardsLock lock{ !kSharded, Access::SHARED };
+        return subtree__unsafe(root, edges, depth, threads);
+    }
+
+    /**
+     * @brief `root` and the Things at most `depth` edges below it along a relation
+     *
+     * Convenience overload, see subtree__unsafe(). The relation stays read locked for
+     * the whole traversal.
+     * This method is threadsafe.
+    */
+    inline std::vector<Uuid> subtree(const Uuid& root, const Relation& relation, size_t depth, size_t threads = 0) {
+        RelationReadLock relation_lock{ relation };
+        AllShardsLock lock{ true, Access::SHARED };
+        return subtree__unsafe(root, RelationEdges{ &_relation_store(relation)->out }, depth, threads);
+    }
+
+    /**
+     * @brief Limits the work of one incremental_step()
+     *
+     * A slice stops as soon as either limit is reached. A unit of work is a Thing
+     * visited, unlinked or destroyed, or 32 slots checked while sweeping.
+    */
+    struct Budget {
+        size_t things;
+        std::chrono::microseconds time;
+
+        explicit Budget(size_t things = SIZE_MAX, std::chrono::microseconds time = std::chrono::microseconds::max())
+            : things(things), time(time) {}
+    };
+
+namespace detail {
+    /**
+     * @brief Counts down a Budget within a slice, the clock is only read every few units
+    */
+    class SliceBudget {
+    private:
+        size_t _left;
+        bool _timed;
+        std::chrono::steady_clock::time_point _deadline;
+        size_t _since_check = 0;
+        bool _exhausted = false;
+
+    public:
+        explicit SliceBudget(const Budget& budget) : _left(budget.things), _timed(budget.time != std::chrono::microseconds::max()) {
+            if (this->_timed) this->_deadline = std::chrono::steady_clock::now() + budget.time;
+        }
+
+        /**
+         * @brief Takes `units` from the budget
+         *
+         * @return false if the budget was already used up
+        */
+        bool spend(size_t units = 1) {
+            if (this->_exhausted) return false;
+            this->_left = (this->_left > units) ? this->_left - units : 0;
+            this->_since_check += units;
+            if (this->_left == 0) this->_exhausted = true;
+            else if (this->_timed && this->_since_check >= 32) {
+                this->_since_check = 0;
+                this->_exhausted = std::chrono::steady_clock::now() >= this->_deadline;
+            }
+            return true;
+        }
+
+        bool exhausted() const { return this->_exhausted; }
+    };
+
+    /**
+     * @brief The work queued by remove_cascade_incremental() and collect_incremental() (per Codex)
+     *
+     * Guarded by all shard locks of its Codex, so only one thread runs incremental_step()
+     * on a Codex at a time.
+    */
+    struct Incremental {
+        // unlinked, their dependents haven't been looked at yet
+        std::vector<ThingPtr> cascade;
+        // marked, their references haven't been looked at yet
+        std::vector<Handle<Thing>> grey;
+        size_t sweep_cursor = 0;
+    };
+
+    /**
+     * @brief Everything a Codex owns, see Codex
+    */
+    struct CodexData : CodexState {
+        Shard shards[kShardCount];
+        Roots roots;
+        Relations relations;
+        GcBarrier gc;
+        Incremental incremental;
+        // never reused, tells Refs resolved in another Codex apart, see Ref
+        const uint64_t serial;
+
+        CodexData() : serial(_next_serial()) {}
+
+        static uint64_t _next_serial() {
+            static std::atomic<uint64_t> serial{ 0 };
+            return ++serial;
+        }
+
+        // the shards are cache line aligned, and over-aligned new needs C++17
+        static void* operator new(size_t size) {
+            void* raw = ::operator new(size + 64);
+            void* aligned = reinterpret_cast<void*>((reinterpret_cast<uintptr_t>(raw) + 64) & ~(uintptr_t)63);
+            static_cast<void**>(aligned)[-1] = raw;
+            return aligned;
+        }
+
+        static void operator delete(void* ptr) {
+            if (ptr != nullptr) ::operator delete(static_cast<void**>(ptr)[-1]);
+        }
+    };
+
+    inline CodexState* _codex_state() { return _codex(); }
+    inline uint64_t _codex_serial() { return _codex()->serial; }
+    inline CodexData* _codex_data(CodexState* state) { return static_cast<CodexData*>(state); }
+    inline Shard* _get_shards() { return _codex()->shards; }
+    inline Roots* _get_roots() { return &_codex()->roots; }
+    inline Relations* _get_relations() { return &_codex()->relations; }
+    inline GcBarrier* _get_gc_barrier() { return &_codex()->gc; }
+    inline Incremental* _get_incremental() { return &_codex()->incremental; }
+
+    /**
+     * @brief Marks the Things reported by visit_refs() and pushes the new ones as Handles
+     *
+     * The Codex is unlocked between slices, so the grey stack can't hold on to pointers.
+    */
+    class HandleMarker : public RefVisitor {
+    private:
+        SlotBitmap& _marked;
+        std::vector<Handle<Thing>>& _grey;
+
+    public:
+        HandleMarker(SlotBitmap& marked, std::vector<Handle<Thing>>& grey) : _marked(marked), _grey(grey) {}
+
+        void mark(Thing* thing) {
+            if (thing == nullptr) return;
+            const Handle<Thing> handle = thing->get_handle();
+            // Things in slots beyond the bitmap were added during the collection
+            if (handle.index < this->_marked.size() && this->_marked.set(handle.index)) this->_grey.push_back(handle);
+        }
+
+        void visit(const Uuid& uuid) override {
+            const ThingPtr* entry = _get_shards()[_shard_index(uuid)].mapping.find(uuid);
+            if (entry != nullptr) this->mark(entry->get());
         }
 
-        Thing() : _uuid(_new_uuid()) {};
+        void visit(const Handle<Thing>& handle) override {
+            if (handle.is_null()) return;
+            this->mark(_get_shards()[_handle_shard(handle.index)].slots.resolve(_handle_slot(handle.index), handle.generation));
+        }
+    };
 
-        /**
-         * @brief The destructor gets called when a Thing is removed from the Codex
-         * 
-         * Removing should always happen through `remove()` as this locks a mutex to
-         * prevent the Codex from getting out of sync with other threads. 
-         * Since `remove()` calls the destructor already, calling `remove()` from within
-         * the destructor would try to lock the mutex again. Therefore, when removing
-         * dependencies from a node (eg children), you should call `remove__unsafe()`
-         * instead of `remove()` since you are already in a 'safe' environment.
-         * If you create new threads in the destructor, you are on your own... Thats way
-         * beyond my knowledge. Try to avoid it if possible :)
-        */
-        virtual ~Thing() {};
+    /**
+     * @brief Hides everything depending on `root` from lookups until a slice unlinks it, all shard lock holder only
+    */
+    inline void _mark_pending__unsafe(const Thing* root) {
+        Shard* shards = _get_shards();
+        std::vector<Uuid> stack;
+        root->dependents(stack);
+        while (!stack.empty()) {
+            const Uuid uuid = stack.back();
+            stack.pop_back();
+            const size_t shard = _shard_index(uuid);
+            const ThingPtr* entry = shards[shard].mapping.find(uuid);
+            if (entry == nullptr || ThingAccess::pending(entry->get())) continue;
+            ThingAccess::set_pending(entry->get());
+            // Refs may have cached the Thing, see Ref::_cached()
+            shards[shard].removals.fetch_add(1, std::memory_order_release);
+            (*entry)->dependents(stack);
+        }
+    }
 
-        /**
-         * @brief uuid getter
-         *
-         * @return uuid
-        */
-        const std::string get_uuid() const { return this->_uuid; }
+    /**
+     * @brief Works off the queued cascades, all shard lock holder only
+    */
+    inline void _cascade_slice__unsafe(Incremental* incremental, SliceBudget& budget, std::vector<ThingPtr>& retired) {
+        std::vector<Uuid> dependents;
+        while (!incremental->cascade.empty() && budget.spend()) {
+            ThingPtr thing = std::move(incremental->cascade.back());
+            incremental->cascade.pop_back();
+            dependents.clear();
+            thing->dependents(dependents);
+            // pending since remove_cascade_incremental(), unlinked now
+            for (const auto& uuid : dependents) {
+                bool found = false;
+                ThingPtr dependent = _unlink__unsafe(_shard_index(uuid), uuid, &found);
+                if (!found) continue;
+                incremental->cascade.push_back(std::move(dependent));
+                budget.spend();
+            }
+            retired.push_back(std::move(thing));
+        }
+    }
 
-        /**
-         * @brief Generates a simple string representation of the object
-         *
-         * @return UUID
-        */
-        virtual const std::string get_repr() const {
-            return "<'" + std::string(typeid(*this).name()) + "' object at [" + this->get_uuid() + "]>";
-        };
-    };
+    /**
+     * @brief Runs the incremental collection, all shard lock holder only
+    */
+    inline void _gc_slice__unsafe(Incremental* incremental, SliceBudget& budget, std::vector<ThingPtr>& retired) {
+        GcBarrier* gc = _get_gc_barrier();
+        if (gc->phase.load(std::memory_order_relaxed) == GcPhase::IDLE) return;
+        std::lock_guard<Mutex> lock{ gc->mutex };
+        Shard* shards = _get_shards();
+        SlotBitmap& marked = *gc->marked;
+
+        if (gc->phase.load(std::memory_order_relaxed) == GcPhase::MARKING) {
+            HandleMarker marker{ marked, incremental->grey };
+            incremental->grey.insert(incremental->grey.end(), gc->added.begin(), gc->added.end());
+            for (const auto& uuid : gc->shaded_uuids) marker.visit(uuid);
+            for (const auto& handle : gc->shaded_handles) marker.visit(handle);
+            gc->added.clear();
+            gc->shaded_uuids.clear();
+            gc->shaded_handles.clear();
+            while (!incremental->grey.empty() && budget.spend()) {
+                const Handle<Thing> handle = incremental->grey.back();
+                incremental->grey.pop_back();
+                // removed since it was marked
+                const Thing* thing = shards[_handle_shard(handle.index)].slots.resolve(_handle_slot(handle.index), handle.generation);
+                if (thing != nullptr) thing->visit_refs(marker);
+            }
+            // nothing can be added or shaded while the shards and the barrier are locked
+            if (!incremental->grey.empty()) return;
+            gc->phase.store(GcPhase::SWEEPING, std::memory_order_release);
+            incremental->sweep_cursor = 0;
+        }
+
+        size_t& cursor = incremental->sweep_cursor;
+        for (size_t checked = 0; cursor < marked.size() && !budget.exhausted(); cursor++) {
+            if (++checked % 32 == 0) budget.spend();
+            const uint32_t index = (uint32_t)cursor;
+            const size_t shard = _handle_shard(index);
+            Thing* thing = shards[shard].slots.at(_handle_slot(index));
+            if (thing == nullptr || marked.test(index)) continue;
+            bool found = false;
+            retired.push_back(_unlink__unsafe(shard, thing->get_id(), &found));
+            budget.spend();
+        }
+        if (cursor < marked.size()) return;
+        gc->phase.store(GcPhase::IDLE, std::memory_order_release);
+        gc->marked.reset();
+    }
+};
 
     /**
-     * @brief Find one Thing with the given UUID and print an error if no object can be found
-     *
-     * This method is not thread safe and you could potentially run into
-     * issues if the codex is modified while this method is running on
-     * another thread.
+     * @brief Removes a Thing now and everything depending on it over the next incremental_step() calls
      *
-     * @tparam T The type of Thing to be retrieved
+     * Like remove_cascade(), but only the Thing itself is unlinked right away. Its
+     * dependents (see Thing::dependents()) are walked once and marked as pending,
+     * which hides the whole subtree from get(), get_many(), Refs and Handles at once.
+     * Each incremental_step() then looks at a bounded number of pending Things: their
+     * dependents are unlinked, and the pending Things are destroyed after the slice.
+     * Unlinking the direct dependents of a single Thing isn't split across slices.
+     * Marking is a lookup and a flag per Thing, unlinking, removal hooks and
+     * destructors are left to the slices. Pending Things still count towards size()
+     * and can still be reached by iterating the Codex until a slice unlinks them.
+     * The rest of the Codex stays usable in between slices.
+     * This method is threadsafe.
      *
-     * @param uuid The UUID to query
+     * @param uuid The UUID of the first Thing to remove
      *
-     * @return A pointer to the Thing if found, otherwise nullptr.
+     * @return Status::SUCCESS or Status::Failure (if UUID not in Codex)
     */
-    template <typename T = Thing>
-    T* get__unsafe(const std::string& uuid) {
-        static_assert(std::is_base_of<Thing, T>::value, "<T> must be a subclass of Thing");
-        auto result = _find_one_by_uuid__unsafe(uuid);
-        return (result != nullptr) ? dynamic_cast<T*>(result) : nullptr;
-    };
+    inline Status remove_cascade_incremental(const Uuid& uuid) {
+        AllShardsLock lock{ true };
+        bool found = false;
+        ThingPtr thing = _unlink__unsafe(_shard_index(uuid), uuid, &found);
+        if (!found) return Status::FAILURE;
+        _mark_pending__unsafe(thing.get());
+        _get_incremental()->cascade.push_back(std::move(thing));
+        return Status::SUCCESS;
+    }
 
     /**
-     * @brief Find one Thing with the given UUID and print an error if no object can be found
+     * @brief Removes a Thing now and everything depending on it over the next incremental_step() calls
      *
+     * Convenience overload, see remove_cascade_incremental(const Uuid&)
      * This method is threadsafe.
-     *
-     * @tparam T The type of Thing to be retrieved
-     *
-     * @param uuid The UUID to query
-     *
-     * @return A pointer to the Thing if found, otherwise nullptr.
     */
-    template <typename T = Thing>
-    T* get(const std::string& uuid) {
-        std::lock_guard<std::mutex> lock{ *_get_mutex() };
-        return get__unsafe<T>(uuid);
+    inline Status remove_cascade_incremental(Thing* ptr) {
+        return remove_cascade_incremental(ptr->get_id());
     }
 
     /**
-     * @brief Remove a Thing from the Codex via UUID
+     * @brief Starts a collection that's worked off by the next incremental_step() calls
      *
-     * This method is not thread safe and you could potentially run into
-     * issues if the codex is modified while this method is running on
-     * another thread.
-     * When removing nodes, you should generally use `remove()`. This locks
-     * a mutex to make a thread safe environment. Therefore, anything in
-     * the destructor can assumed to be threadsafe. To avoid locking the
-     * same mutex again, use `remove__unsafe()` in the destructor to delete
-     * dependencies.
-     *
-     * @param uuid The UUID of the object to remove
+     * Same result as collect(), but marking and sweeping are split into slices and
+     * the Codex is unlocked in between. Things added meanwhile survive the
+     * collection. References stored into Things that are already in the Codex
+     * have to be reported with write_barrier() until the collection is done,
+     * otherwise their targets may be collected while still referenced.
+     * This method is threadsafe.
      *
-     * @return Status::SUCCESS or Status::Failure (if UUID not in Codex)
+     * @return Status::SUCCESS or Status::Failure (if a collection is already running)
     */
-    Status remove__unsafe(const std::string& uuid) {
-        Thing* entry = get__unsafe<Thing>(uuid);
-        if (entry == nullptr) {
-            return Status::FAILURE;
+    inline Status collect_incremental() {
+        AllShardsLock lock{ true };
+        GcBarrier* gc = _get_gc_barrier();
+        std::lock_guard<Mutex> gc_lock{ gc->mutex };
+        if (gc->phase.load(std::memory_order_relaxed) != GcPhase::IDLE) return Status::FAILURE;
+        gc->marked.reset(new SlotBitmap(_handle_index_count__unsafe()));
+        Incremental* incremental = _get_incremental();
+        HandleMarker marker{ *gc->marked, incremental->grey };
+        {
+            Roots* roots = _get_roots();
+            std::lock_guard<Mutex> roots_lock{ roots->mutex };
+            for (const auto& root : roots->uuids) marker.visit(root.key);
         }
-        _get_mapping()->erase(uuid);
+        gc->phase.store(GcPhase::MARKING, std::memory_order_release);
         return Status::SUCCESS;
-    };
+    }
 
     /**
-     * @brief Remove a Thing from the Codex via UUID
+     * @brief Reports a reference stored into a Thing to a running collect_incremental()
      *
+     * Only does something while a collection is marking, a single atomic load otherwise.
      * This method is threadsafe.
      *
-     * @param uuid The UUID of the object to remove
+     * @param uuid The UUID that has been stored
+    */
+    inline void write_barrier(const Uuid& uuid) {
+        _gc_shade(uuid);
+    }
+
+    /**
+     * @brief Reports a reference stored into a Thing to a running collect_incremental()
      *
-     * @return Status::SUCCESS or Status::Failure (if UUID not in Codex)
+     * Convenience overload, see write_barrier(const Uuid&)
+     * This method is threadsafe.
     */
-    Status remove(const std::string& uuid) {
-        std::lock_guard<std::mutex> lock{ *_get_mutex() };
-        return remove__unsafe(uuid);
+    inline void write_barrier(const Handle<Thing>& handle) {
+        _gc_shade(handle);
     }
 
     /**
-     * @brief Remove a Thing form the Codex via pointer
+     * @brief Runs one slice of the pending remove_cascade_incremental() and collect_incremental() work
      *
+     * The Codex is locked for the duration of the slice, the Things removed in it
+     * are destroyed after it has been unlocked. Call it once per frame (or whenever
+     * there's time) until it returns false. Only one thread runs a slice at a time.
      * This method is threadsafe.
      *
-     * @param ptr A ptr to the Thing to remove
+     * @param budget Limits the work done in this slice
      *
-     * @return Status::SUCCESS or Status::Failure (if UUID not in Codex)
+     * @return true if there's work left
+    */
+    inline bool incremental_step(const Budget& budget = Budget(1024)) {
+        Incremental* incremental = _get_incremental();
+        std::vector<ThingPtr> retired;
+        bool pending;
+        {
+            SliceBudget slice{ budget };
+            AllShardsLock lock{ true };
+            _cascade_slice__unsafe(incremental, slice, retired);
+            if (!slice.exhausted()) _gc_slice__unsafe(incremental, slice, retired);
+            pending = !incremental->cascade.empty() || _get_gc_barrier()->phase.load(std::memory_order_relaxed) != GcPhase::IDLE;
+        }
+        for (auto& thing : retired) _retire(std::move(thing));
+        _reclaim_deferred();
+        return pending;
+    }
+
+    /**
+     * @brief Whether remove_cascade_incremental() or collect_incremental() left work for incremental_step()
+     *
+     * This method is threadsafe.
+    */
+    inline bool incremental_pending() {
+        AllShardsLock lock{ true, Access::SHARED };
+        return !_get_incremental()->cascade.empty() || _get_gc_barrier()->phase.load(std::memory_order_relaxed) != GcPhase::IDLE;
+    }
+
+    /**
+     * @brief Waits for the destructors of all Things removed so far
+     *
+     * Destructors normally run right after remove() released its lock, so this only
+     * makes a difference with DH_CODEX_BACKGROUND_RECLAIM (waits for the background
+     * thread) and DH_CODEX_LOCKFREE_READS (destroys what readers no longer hold on to).
+     * Does nothing when called from a destructor.
+     * This method is threadsafe.
     */
-    Status remove(Thing* ptr) {
-        std::lock_guard<std::mutex> lock{ *_get_mutex() };
-        return remove__unsafe(ptr->get_uuid());
+    inline void reclaim() {
+        if (_destruction_depth() > 0) return;
+        _reclaim_deferred();
+        Reclaimer* reclaimer = kBackgroundReclaim ? _get_reclaimer() : nullptr;
+        if (reclaimer != nullptr) reclaimer->wait();
     }
 
     /**
@@ -389,11 +5585,16 @@ namespace {
      * This method is not thread safe and you could potentially run into
      * issues if the codex is modified while this method is running on
      * another thread.
+     * In sharded mode (DH_CODEX_SHARDS > 1) all shards get locked, except the
+     * ones the calling thread already holds.
      *
      * @return Number of Things in the Codex
     */
-    const size_t size__unsafe() {
-        return _get_mapping()->size();
+    inline const size_t size__unsafe() {
+        AllShardsLock lock{ _self_locking(), Access::SHARED };
+        size_t count = 0;
+        for (size_t shard = 0; shard < kShardCount; shard++) count += _get_shards()[shard].mapping.size();
+        return count;
     }
 
     /**
@@ -403,8 +5604,8 @@ namespace {
      *
      * @return Number of Things in the Codex
     */
-    const size_t size() {
-        std::lock_guard<std::mutex> lock{ *_get_mutex() };
+    inline const size_t size() {
+        AllShardsLock lock{ true, Access::SHARED };
         return size__unsafe();
     }
 
@@ -416,27 +5617,40 @@ namespace {
      * issues if the codex is modified while this method is running on
      * another thread.
      *
+     * The entries are sorted by UUID, so the output does not depend on the
+     * layout of the hash table. With DH_CODEX_UUID_V7 that's creation order.
+     * In sharded mode (DH_CODEX_SHARDS > 1) all shards get locked, except the
+     * ones the calling thread already holds.
+     *
      * @parm print_to_stdout If true, sends string to stdout
      *
      * @return Same string that gets printed
     */
-    std::string list_entries__unsafe(const bool& print = true) {
-        auto _mapping = _get_mapping();
+    inline std::string list_entries__unsafe(const bool& print = true) {
+        AllShardsLock lock{ _self_locking(), Access::SHARED };
+        std::vector<const Thing*> entries;
+        entries.reserve(size__unsafe());
+        for (size_t shard = 0; shard < kShardCount; shard++) {
+            for (const auto& slot : _get_shards()[shard].mapping) entries.push_back(slot.value.get());
+        }
+        std::sort(entries.begin(), entries.end(), [](const Thing* a, const Thing* b) { return a->get_id() < b->get_id(); });
+
         std::string line = "+---------------------------------------------";
         std::string prefix = "\n| Codex:\n";
         std::string content = "";
-        for (auto it = _mapping->begin(); it != _mapping->end(); it++) {
-            std::string repr = it->second->get_repr();
+        for (auto it = entries.begin(); it != entries.end(); it++) {
+            const std::string uuid = (*it)->get_uuid();
+            std::string repr = (*it)->get_repr();
             std::string repr_offset = "";
             std::string indent = "|       ";
-            for(int _=0; _<it->first.size(); _++) indent += " ";
+            for(int _=0; _<uuid.size(); _++) indent += " ";
 
             for (int idx=0; idx<repr.size(); idx++) {
                 repr_offset += repr.at(idx);
                 if (repr.at(idx) == '\n') repr_offset += indent;
             }
 
-            content += "|    [" + it->first + "] " + repr_offset + "\n";
+            content += "|    [" + uuid + "] " + repr_offset + "\n";
         }
         if (print) { std::cout << line << prefix << content << line << std::endl; }
         return line + prefix + content + line + "\n";
@@ -451,11 +5665,410 @@ namespace {
      *
      * @return Same string that gets printed
     */
-    std::string list_entries(const bool& print = true) {
-        std::lock_guard<std::mutex> lock{ *_get_mutex() };
+    inline std::string list_entries(const bool& print = true) {
+        AllShardsLock lock{ true, Access::SHARED };
         return list_entries__unsafe(print);
     }
+
+namespace detail {
+    /**
+     * @brief Destroys all Things of `codex` at once, without running their removal hooks
+     *
+     * Everything is unlinked before the first destructor runs, so destructors can't
+     * look up Things that are already gone. Things removed earlier whose destruction
+     * is still pending (DH_CODEX_BACKGROUND_RECLAIM, DH_CODEX_LOCKFREE_READS) are
+     * destroyed first.
+    */
+    inline void _clear(CodexData* codex) {
+        CodexScope scope{ codex };
+        auto settle = []() {
+            reclaim();
+            if (!kLockFreeReads) return;
+            _get_epoch_domain()->synchronize();
+            reclaim();
+        };
+        settle();
+        std::vector<ThingPtr> things;
+        {
+            AllShardsLock lock{ true, Access::EXCLUSIVE };
+            for (Shard& shard : codex->shards) {
+                for (auto& slot : shard.mapping) {
+                    if (kLockFreeReads) shard.index.erase(slot.key);
+                    things.push_back(std::move(slot.value));
+                }
+                shard.mapping.clear();
+            }
+            for (auto& thing : codex->incremental.cascade) things.push_back(std::move(thing));
+            codex->incremental.cascade.clear();
+        }
+        things.clear();
+        settle();
+    }
+};
+
+    /**
+     * @brief A Codex of its own, independent of the default one
+     *
+     * Every Codex has its own shards and locks, roots, relations and collector state,
+     * so Codices never contend with each other and can be used for separate
+     * subsystems, tenants or tests running in parallel. The free functions work on
+     * the default Codex (see default_codex()), except when called through run().
+     * The member functions are the free functions of the same name, working on this
+     * Codex instead.
+     * A Thing belongs to the Codex it has been added to. Its removal hooks and
+     * destructor run with that Codex current, so removing dependents or creating
+     * Things from there stays within it.
+     * Destroying a Codex destroys all of its Things in one go, without running their
+     * removal hooks, just like the default Codex does at exit. Don't destroy a Codex
+     * while other threads are still using it. Refs, Handles and Relations are only
+     * meaningful within the Codex they came from.
+    */
+    class Codex {
+    private:
+        std::unique_ptr<CodexState> _state;
+
+        friend class CodexAccess;
+
+    public:
+        Codex();
+        ~Codex();
+        Codex(const Codex&) = delete;
+        Codex& operator=(const Codex&) = delete;
+
+        /**
+         * @brief Calls `function` with this Codex as the calling thread's current one
+         *
+         * All free functions called from `function`, directly or not, work on this
+         * Codex, eg `codex.run([&]() { return dh::codex::link(a, b); })`. Can be nested,
+         * also with other Codices.
+         *
+         * @return Whatever `function` returns
+        */
+        template <typename F>
+        auto run(F&& function) -> decltype(function()) {
+            CodexScope scope{ _codex_data(this->_state.get()) };
+            return function();
+        }
+
+        template <typename T>
+        T* add(std::unique_ptr<T> ptr) {
+            return this->run([&]() { return dh::codex::add<T>(std::move(ptr)); });
+        }
+
+        template <typename T, typename... Args>
+        T* emplace(Args&&... args) {
+            CodexScope scope{ _codex_data(this->_state.get()) };
+            return dh::codex::emplace<T>(std::forward<Args>(args)...);
+        }
+
+        template <typename T = Thing>
+        T* get(const Uuid& uuid) {
+            return this->run([&]() { return dh::codex::get<T>(uuid); });
+        }
+
+        template <typename T = Thing>
+        T* get(const std::string& uuid) {
+            return this->run([&]() { return dh::codex::get<T>(uuid); });
+        }
+
+        template <typename T>
+        T* get(const Handle<T>& handle) {
+            return this->run([&]() { return dh::codex::get<T>(handle); });
+        }
+
+        template <typename T = Thing>
+        std::vector<T*> get_many(const std::vector<Uuid>& uuids) {
+            return this->run([&]() { return dh::codex::get_many<T>(uuids); });
+        }
+
+        Status remove(const Uuid& uuid) {
+            return this->run([&]() { return dh::codex::remove(uuid); });
+        }
+
+        Status remove(const std::string& uuid) {
+            return this->run([&]() { return dh::codex::remove(uuid); });
+        }
+
+        Status remove(Thing* ptr) {
+            return this->run([&]() { return dh::codex::remove(ptr); });
+        }
+
+        size_t remove_many(const std::vector<Uuid>& uuids) {
+            return this->run([&]() { return dh::codex::remove_many(uuids); });
+        }
+
+        size_t remove_cascade(const Uuid& uuid) {
+            return this->run([&]() { return dh::codex::remove_cascade(uuid); });
+        }
+
+        size_t remove_cascade(Thing* ptr) {
+            return this->run([&]() { return dh::codex::remove_cascade(ptr); });
+        }
+
+        size_t collect(size_t threads = 0) {
+            return this->run([&]() { return dh::codex::collect(threads); });
+        }
+
+        size_t size() {
+            return this->run([]() { return dh::codex::size(); });
+        }
+
+        std::string list_entries(const bool& print = true) {
+            return this->run([&]() { return dh::codex::list_entries(print); });
+        }
+    };
+
+    class CodexAccess {
+    public:
+        static CodexState* state(const Codex& codex) {
+            return codex._state.get();
+        }
+    };
+
+    inline Codex::Codex() : _state(new CodexData()) {}
+
+    inline Codex::~Codex() {
+        _clear(_codex_data(this->_state.get()));
+    }
+
+    /**
+     * @brief The Codex the free functions work on, unless called through Codex::run()
+     *
+     * Its Things are destroyed at exit, the Codex itself is intentionally leaked so
+     * destructors running at exit can still use it.
+     * This method is threadsafe.
+    */
+    inline Codex& default_codex() {
+        struct Holder {
+            Codex* codex = new Codex();
+            ~Holder() { _clear(_codex_data(CodexAccess::state(*this->codex))); }
+        };
+        // Things still in the Codex at exit may retire others from their destructor,
+        // so the epoch domain has to outlive the Codex
+        if (kLockFreeReads) _get_epoch_domain();
+        static Holder holder;
+        return *holder.codex;
+    }
+
+namespace detail {
+    /**
+     * @brief Everything a Session holds on to
+     *
+     * `lock` is taken once `scope` made the Session's Codex current and released
+     * before the scope ends.
+    */
+    struct SessionData : SessionState {
+        /**
+         * @brief One add or remove, undone by rollback()
+        */
+        struct Change {
+            // the Thing added, nullptr for a remove
+            Thing* added;
+            // the Thing removed, or replaced by `added`, unlinked but alive until commit()
+            ThingPtr removed;
+        };
+
+        CodexScope scope;
+        AllShardsLock lock;
+        // the changes since the last commit()/rollback(), in the order they were made
+        std::vector<Change> changes;
+
+        explicit SessionData(CodexData* codex) : scope(codex), lock(true, Access::EXCLUSIVE) {}
+    };
+
+    inline SessionData* _session_data(SessionState* state) { return static_cast<SessionData*>(state); }
+};
+
+    /**
+     * @brief Locks a Codex once for a whole block of operations
+     *
+     * Takes all shards of the Codex exclusively for as long as the Session lives
+     * (shards the calling thread already holds are skipped), so its get(), add(),
+     * remove() and for_each() never lock again, and other threads see either all
+     * or none of the changes made in between two commit()s.
+     * Adds take effect right away. Removes unlink the Thing right away as well,
+     * but its removal hooks and destructor only run once it is committed and the
+     * Session has ended. The same goes for a Thing replaced by adding one with the
+     * same UUID. rollback() puts the removed and replaced Things back (their
+     * Handles go stale) and removes the added ones again, running their removal
+     * hooks like any other remove(). A Session ending without commit() is rolled
+     * back.
+     * With DH_CODEX_LOCKFREE_READS, get() on other threads doesn't wait for the
+     * Session and sees its changes as they happen.
+     * A Session belongs to the thread that created it and makes its Codex the
+     * current one for that thread until it ends. Don't create a Session from
+     * within a hook or destructor running for a removal in the same Codex.
+    */
+    class Session {
+    private:
+        CodexState* _codex;
+        std::unique_ptr<SessionState> _state;
+
+        explicit Session(CodexState* codex) : _codex(codex), _state(new SessionData(_codex_data(codex))) {}
+
+    public:
+        /**
+         * @brief Starts a Session on the calling thread's current Codex
+        */
+        Session() : Session(_codex_state()) {}
+
+        /**
+         * @brief Starts a Session on `codex`
+        */
+        explicit Session(Codex& codex) : Session(CodexAccess::state(codex)) {}
+
+        ~Session() {
+            this->rollback();
+            this->_state.reset();
+            // the committed removals, once the shards are released
+            _reclaim_deferred();
+        }
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+        template <typename T = Thing>
+        T* get(const Uuid& uuid) {
+            CodexScope scope{ _codex_data(this->_codex) };
+            return get__unsafe<T>(uuid);
+        }
+
+        template <typename T = Thing>
+        T* get(const std::string& uuid) {
+            return this->get<T>(Uuid::from_string(uuid));
+        }
+
+        template <typename T>
+        T* get(const Handle<T>& handle) {
+            CodexScope scope{ _codex_data(this->_codex) };
+            return get__unsafe<T>(handle);
+        }
+
+        template <typename T = Thing>
+        std::vector<T*> get_many(const std::vector<Uuid>& uuids) {
+            CodexScope scope{ _codex_data(this->_codex) };
+            std::vector<T*> result(uuids.size());
+            get_many__unsafe<T>(uuids.data(), uuids.size(), result.data());
+            return result;
+        }
+
+        /**
+         * @brief Adds the Thing, a Thing with the same UUID is replaced but kept until commit()
+        */
+        template <typename T>
+        T* add(std::unique_ptr<T> ptr) {
+            static_assert(std::is_base_of<Thing, T>::value, "T must inherit from Thing");
+            CodexScope scope{ _codex_data(this->_codex) };
+            ThingPtr replaced;
+            T* result = _add__unsafe<T>(std::move(ptr), &replaced);
+            _session_data(this->_state.get())->changes.push_back({ result, std::move(replaced) });
+            return result;
+        }
+
+        /**
+         * @brief Constructs and adds a Thing, see add()
+        */
+        template <typename T, typename... Args>
+        T* emplace(Args&&... args) {
+            static_assert(std::is_base_of<Thing, T>::value, "T must inherit from Thing");
+            CodexScope scope{ _codex_data(this->_codex) };
+            ThingPtr replaced;
+            T* result = _add__unsafe<T>(_construct<T>(std::forward<Args>(args)...), &replaced);
+            _session_data(this->_state.get())->changes.push_back({ result, std::move(replaced) });
+            return result;
+        }
+
+        /**
+         * @brief Unlinks the Thing, its removal hooks and destructor wait for commit()
+        */
+        Status remove(const Uuid& uuid) {
+            CodexScope scope{ _codex_data(this->_codex) };
+            bool found = false;
+            ThingPtr thing = _unlink__unsafe(_shard_index(uuid), uuid, &found);
+            if (found) _session_data(this->_state.get())->changes.push_back({ nullptr, std::move(thing) });
+            return found ? Status::SUCCESS : Status::FAILURE;
+        }
+
+        Status remove(const std::string& uuid) {
+            return this->remove(Uuid::from_string(uuid));
+        }
+
+        Status remove(Thing* ptr) {
+            return this->remove(ptr->get_id());
+        }
+
+        size_t size() {
+            CodexScope scope{ _codex_data(this->_codex) };
+            return size__unsafe();
+        }
+
+        /**
+         * @brief Calls `function` with every Thing of type T in the Codex
+         *
+         * The order is unspecified. Don't add or remove Things from within `function`.
+        */
+        template <typename T = Thing, typename F>
+        void for_each(F&& function) {
+            CodexScope scope{ _codex_data(this->_codex) };
+            for (Shard& shard : _codex_data(this->_codex)->shards) {
+                for (auto& slot : shard.mapping) {
+                    T* thing = thing_cast<T>(slot.value.get());
+                    if (thing != nullptr) function(thing);
+                }
+            }
+        }
+
+        /**
+         * @brief Makes the changes since the last commit()/rollback() permanent
+         *
+         * Removed Things are destroyed once the Session has ended.
+        */
+        void commit() {
+            SessionData* data = _session_data(this->_state.get());
+            for (auto& change : data->changes) {
+                if (change.removed) _retire(std::move(change.removed));
+            }
+            data->changes.clear();
+        }
+
+        /**
+         * @brief Undoes the changes since the last commit()/rollback()
+         *
+         * The changes are undone in reverse order: added Things are removed again
+         * (running their removal hooks like any other remove()), removed and replaced
+         * ones are put back.
+        */
+        void rollback() {
+            CodexScope scope{ _codex_data(this->_codex) };
+            SessionData* data = _session_data(this->_state.get());
+            for (auto it = data->changes.rbegin(); it != data->changes.rend(); it++) {
+                if (it->added != nullptr) {
+                    const Uuid uuid = it->added->get_id();
+                    bool found = false;
+                    ThingPtr thing = _unlink__unsafe(_shard_index(uuid), uuid, &found);
+                    if (found) _retire(std::move(thing));
+                }
+                if (it->removed) _add__unsafe(std::move(it->removed));
+            }
+            data->changes.clear();
+        }
+    };
+
+namespace detail {
+    inline CodexData* _default_codex_data() {
+        static CodexData* codex = _codex_data(CodexAccess::state(default_codex()));
+        return codex;
+    }
 };
 };
+};
+
+// allows dh::codex::Uuid to be used in std::unordered_map/std::unordered_set
+namespace std {
+    template<>
+    struct hash<dh::codex::Uuid> {
+        size_t operator()(const dh::codex::Uuid& uuid) const { return uuid.hash(); }
+    };
+};
 
 #endif // !DH_CODEX_IMPLEMENTATION
@@ -0,0 +1,624 @@
+/* dhCodex - C++ - benchmarks
+
+Small, dependency free benchmarks for dhCodex.hpp. The Codex is configured at compile
+time, so to compare configurations build this file once per configuration, eg:
+
+    g++ -std=c++14 -O2 -pthread dhCodex_benchmark.cpp -o bench_mutex
+    g++ -std=c++14 -O2 -pthread -DDH_CODEX_SHARED_MUTEX dhCodex_benchmark.cpp -o bench_rw
+    g++ -std=c++14 -O2 -pthread -DDH_CODEX_SYSTEM_UUID dhCodex_benchmark.cpp -luuid -o bench_libuuid
+
+The configurations worth comparing, one axis each:
+
+    locking     (default: one mutex)    -DDH_CODEX_SINGLE_THREADED
+                -DDH_CODEX_SHARED_MUTEX -DDH_CODEX_SHARDS=16
+                -DDH_CODEX_SHARDS=16 -DDH_CODEX_LOCKFREE_READS
+    UUIDs       (default: random v4)    -DDH_CODEX_UUID_V7
+                -DDH_CODEX_SEQUENTIAL_UUID -DDH_CODEX_SYSTEM_UUID
+    reclaiming  (default: inline)       -DDH_CODEX_BACKGROUND_RECLAIM
+
+The Makefile next to this file builds and runs the benchmarks once for every
+combination of locking mode and UUID scheme (15 builds, named <lock>-<id>):
+
+    make matrix                                 all benchmarks, every combination
+    make matrix BENCHMARKS="single_thread"      the given benchmarks only
+
+With DH_CODEX_SINGLE_THREADED the multi threaded benchmarks run on one thread and
+ref is left out, since it needs a second thread adding and removing Things.
+
+Usage:
+    ./bench_mutex               runs all benchmarks
+    ./bench_mutex <name> ...    runs the given benchmarks only
+*/
+
+#include "dhCodex.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    size_t _thread_count() {
+#ifdef DH_CODEX_SINGLE_THREADED
+        return 1;
+#else
+        const size_t hardware = std::thread::hardware_concurrency();
+        return (hardware < 4) ? 4 : hardware;
+#endif
+    }
+
+    /**
+     * @brief Read throughput with 1%, 10% and 50% of the operations being add/remove pairs
+     *
+     * Every thread runs for a fixed amount of time, picking either a get() of a random
+     * pre-populated Thing or an add() followed by remove() of a new Thing.
+    */
+    void bench_read_write_mix() {
+        const size_t populated = 100000;
+        const size_t threads = _thread_count();
+        const auto duration = std::chrono::milliseconds(500);
+
+        std::vector<dh::codex::Uuid> uuids;
+        uuids.reserve(populated);
+        for (size_t idx = 0; idx < populated; idx++) uuids.push_back(dh::codex::Thing::create()->get_id());
+
+        std::printf("read_write_mix (%zu threads, %zu Things)\n", threads, populated);
+        for (const int write_percent : { 1, 10, 50 }) {
+            std::atomic<bool> stop{ false };
+            std::atomic<uint64_t> reads{ 0 };
+            std::atomic<uint64_t> writes{ 0 };
+            std::vector<std::thread> workers;
+            for (size_t thread = 0; thread < threads; thread++) {
+                workers.emplace_back([&, thread]() {
+                    std::mt19937_64 rng(thread + 1);
+                    uint64_t local_reads = 0;
+                    uint64_t local_writes = 0;
+                    while (!stop.load(std::memory_order_relaxed)) {
+                        if ((int)(rng() % 100) < write_percent) {
+                            dh::codex::remove(dh::codex::Thing::create());
+                            local_writes++;
+                        }
+                        else {
+                            dh::codex::get(uuids[rng() % uuids.size()]);
+                            local_reads++;
+                        }
+                    }
+                    reads += local_reads;
+                    writes += local_writes;
+                });
+            }
+            std::this_thread::sleep_for(duration);
+            stop = true;
+            for (auto& worker : workers) worker.join();
+
+            const double seconds = std::chrono::duration<double>(duration).count();
+            std::printf("    %2d%% writes: %12.0f reads/s %12.0f writes/s\n", write_percent,
+                        reads.load() / seconds, writes.load() / seconds);
+        }
+
+        for (const auto& uuid : uuids) dh::codex::remove(uuid);
+    }
+
+    /**
+     * @brief Latency of the basic calls on one thread, where all that's left of the locking is its overhead
+    */
+    void bench_single_thread() {
+        const size_t populated = 100000;
+        const size_t rounds = 2000000;
+
+        std::vector<dh::codex::Uuid> uuids;
+        uuids.reserve(populated);
+        for (size_t idx = 0; idx < populated; idx++) uuids.push_back(dh::codex::Thing::create()->get_id());
+
+        std::printf("single_thread (%zu Things)\n", populated);
+        {
+            size_t found = 0;
+            const auto start = Clock::now();
+            for (size_t idx = 0; idx < rounds; idx++) found += dh::codex::get(uuids[(idx * 7919) % populated]) != nullptr;
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    get():           %8.1f ns (found %zu)\n", seconds * 1e9 / rounds, found);
+        }
+        {
+            const size_t pairs = rounds / 4;
+            const auto start = Clock::now();
+            for (size_t idx = 0; idx < pairs; idx++) dh::codex::remove(dh::codex::Thing::create());
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    create+remove(): %8.1f ns\n", seconds * 1e9 / pairs);
+        }
+        for (const auto& uuid : uuids) dh::codex::remove(uuid);
+    }
+
+    /**
+     * @brief UUID generation throughput, single threaded and on all threads
+     *
+     * Also measures bulk creation of Things, which is where UUID generation used to
+     * show up in profiles.
+    */
+    void bench_uuid_generation() {
+        const size_t count = 2000000;
+        const size_t threads = _thread_count();
+
+        std::printf("uuid_generation\n");
+        {
+            uint64_t checksum = 0;
+            const auto start = Clock::now();
+            for (size_t idx = 0; idx < count; idx++) checksum ^= dh::codex::Uuid::generate().lo;
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    1 thread:   %12.0f uuids/s (checksum %llx)\n", count / seconds, (unsigned long long)checksum);
+        }
+        {
+            std::vector<std::thread> workers;
+            const auto start = Clock::now();
+            for (size_t thread = 0; thread < threads; thread++) {
+                workers.emplace_back([&]() {
+                    volatile uint64_t checksum = 0;
+                    for (size_t idx = 0; idx < count; idx++) checksum = checksum ^ dh::codex::Uuid::generate().lo;
+                });
+            }
+            for (auto& worker : workers) worker.join();
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    %zu threads: %12.0f uuids/s\n", threads, threads * count / seconds);
+        }
+        {
+            const size_t things = count / 4;
+            std::vector<dh::codex::Thing*> created;
+            created.reserve(things);
+            const auto start = Clock::now();
+            for (size_t idx = 0; idx < things; idx++) created.push_back(dh::codex::Thing::create());
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    Thing::create(): %12.0f Things/s\n", things / seconds);
+            for (auto thing : created) dh::codex::remove(thing);
+        }
+    }
+
+    /**
+     * @brief Resolving the 10k children of one node, one get() per child vs one get_many()
+    */
+    void bench_get_many() {
+        const size_t children = 10000;
+        const size_t rounds = 200;
+        std::vector<dh::codex::Uuid> uuids;
+        uuids.reserve(children);
+        for (size_t idx = 0; idx < children; idx++) uuids.push_back(dh::codex::Thing::create()->get_id());
+
+        std::printf("get_many (%zu children)\n", children);
+        std::vector<dh::codex::Thing*> out(children);
+        {
+            const auto start = Clock::now();
+            for (size_t round = 0; round < rounds; round++) {
+                for (size_t idx = 0; idx < children; idx++) out[idx] = dh::codex::get(uuids[idx]);
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    get() loop: %12.0f lookups/s\n", rounds * children / seconds);
+        }
+        {
+            const auto start = Clock::now();
+            for (size_t round = 0; round < rounds; round++) dh::codex::get_many(uuids.data(), children, out.data());
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    get_many(): %12.0f lookups/s\n", rounds * children / seconds);
+        }
+
+        for (const auto& uuid : uuids) dh::codex::remove(uuid);
+    }
+
+    /**
+     * @brief Loading a scene, one add() per Thing vs one add_many()
+    */
+    void bench_add_many() {
+        const size_t count = 1000000;
+        std::printf("add_many (%zu Things)\n", count);
+        for (const bool batched : { false, true }) {
+            std::vector<std::unique_ptr<dh::codex::Thing>> things;
+            things.reserve(count);
+            for (size_t idx = 0; idx < count; idx++) things.push_back(std::make_unique<dh::codex::Thing>());
+
+            std::vector<dh::codex::Thing*> added;
+            const auto start = Clock::now();
+            if (batched) {
+                added = dh::codex::add_many(std::move(things));
+            }
+            else {
+                added.reserve(count);
+                for (auto& thing : things) added.push_back(dh::codex::add(std::move(thing)));
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    %s %12.0f Things/s\n", batched ? "add_many():" : "add() loop:", count / seconds);
+            for (auto thing : added) dh::codex::remove(thing);
+        }
+    }
+
+    struct Particle : dh::codex::Thing {
+        float position[3] = {};
+        float velocity[3] = {};
+        explicit Particle(float x) { this->position[0] = x; }
+    };
+
+    /**
+     * @brief Creating, touching and removing Things, add(std::make_unique()) vs emplace()
+    */
+    void bench_emplace() {
+        const size_t count = 1000000;
+        std::printf("emplace (%zu Things)\n", count);
+        for (const bool emplaced : { false, true }) {
+            std::vector<Particle*> particles;
+            particles.reserve(count);
+            auto start = Clock::now();
+            for (size_t idx = 0; idx < count; idx++) {
+                if (emplaced) particles.push_back(dh::codex::emplace<Particle>((float)idx));
+                else particles.push_back(dh::codex::add(std::make_unique<Particle>((float)idx)));
+            }
+            const double create = std::chrono::duration<double>(Clock::now() - start).count();
+
+            start = Clock::now();
+            float sum = 0.0f;
+            for (auto particle : particles) sum += particle->position[0];
+            const double touch = std::chrono::duration<double>(Clock::now() - start).count();
+
+            start = Clock::now();
+            for (auto particle : particles) dh::codex::remove(particle);
+            const double destroy = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    %s create %10.0f/s, touch %12.0f/s, remove %10.0f/s (%g)\n", emplaced ? "emplace():" : "add():    ",
+                        count / create, count / touch, count / destroy, sum);
+        }
+    }
+
+    // a deep hierarchy, registered and unregistered
+    struct Level1 : dh::codex::Thing { DH_CODEX_THING(Level1, dh::codex::Thing) };
+    struct Level2 : Level1 { DH_CODEX_THING(Level2, Level1) };
+    struct Level3 : Level2 { DH_CODEX_THING(Level3, Level2) };
+    struct Level4 : Level3 { DH_CODEX_THING(Level4, Level3) };
+    struct Level5 : Level4 { DH_CODEX_THING(Level5, Level4) };
+    struct Plain1 : dh::codex::Thing {};
+    struct Plain2 : Plain1 {};
+    struct Plain3 : Plain2 {};
+    struct Plain4 : Plain3 {};
+    struct Plain5 : Plain4 {};
+
+    template <typename Leaf, typename Query>
+    double _typed_get_rate(size_t count, size_t lookups) {
+        std::vector<dh::codex::Uuid> uuids;
+        uuids.reserve(count);
+        for (size_t idx = 0; idx < count; idx++) uuids.push_back(dh::codex::add(std::make_unique<Leaf>())->get_id());
+        size_t found = 0;
+        const auto start = Clock::now();
+        for (size_t idx = 0; idx < lookups; idx++) found += dh::codex::get<Query>(uuids[idx % count]) != nullptr;
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        for (const auto& uuid : uuids) dh::codex::remove(uuid);
+        return (found == lookups) ? lookups / seconds : 0.0;
+    }
+
+    template <typename Cast>
+    double _cast_rate(const std::vector<dh::codex::Thing*>& things, size_t rounds, Cast cast, size_t* found) {
+        *found = 0;
+        const auto start = Clock::now();
+        for (size_t round = 0; round < rounds; round++) {
+            for (dh::codex::Thing* thing : things) *found += cast(thing) != nullptr;
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return (things.size() * rounds) / seconds;
+    }
+
+    /**
+     * @brief get<T>() on a five level deep hierarchy, registered through DH_CODEX_THING or not
+     *
+     * Queries the middle of the hierarchy, which is the expensive case for dynamic_cast.
+     * get<T>() is mostly the lookup and its lock, so the cast itself is measured on
+     * pointers fetched beforehand as well: thing_cast<T>() vs dynamic_cast on the
+     * same objects, half of them a T.
+    */
+    void bench_typed_get() {
+        const size_t count = 10000;
+        const size_t lookups = 5000000;
+        std::printf("typed_get (%zu Things, 5 levels deep)\n", count);
+        std::printf("    DH_CODEX_THING: %12.0f gets/s\n", _typed_get_rate<Level5, Level3>(count, lookups));
+        std::printf("    dynamic_cast:   %12.0f gets/s\n", _typed_get_rate<Plain5, Plain3>(count, lookups));
+
+        std::vector<dh::codex::Thing*> things;
+        for (size_t idx = 0; idx < count; idx++) {
+            if (idx % 2 == 0) things.push_back(dh::codex::emplace<Level5>());
+            else things.push_back(dh::codex::emplace<Level1>());
+        }
+        const size_t rounds = lookups / count;
+        size_t registered_found;
+        size_t dynamic_found;
+        const double registered = _cast_rate(things, rounds, [](dh::codex::Thing* thing) { return dh::codex::thing_cast<Level3>(thing); }, &registered_found);
+        const double dynamic = _cast_rate(things, rounds, [](dh::codex::Thing* thing) { return dynamic_cast<Level3*>(thing); }, &dynamic_found);
+        std::printf("    casts only, thing_cast<T>(): %12.0f casts/s (found %zu)\n", registered, registered_found);
+        std::printf("    casts only, dynamic_cast:    %12.0f casts/s (found %zu)\n", dynamic, dynamic_found);
+        for (dh::codex::Thing* thing : things) dh::codex::remove(thing);
+    }
+
+    struct Node : dh::codex::Thing {
+        std::vector<dh::codex::Uuid> children;
+        void dependents(std::vector<dh::codex::Uuid>& out) const override { out.insert(out.end(), this->children.begin(), this->children.end()); }
+        void visit_refs(dh::codex::RefVisitor& visitor) const override { for (const auto& child : this->children) visitor.visit(child); }
+    };
+
+    // a tree with `count` Nodes and 8 children per Node
+    Node* _build_tree(size_t count) {
+        Node* root = dh::codex::emplace<Node>();
+        std::vector<Node*> nodes{ root };
+        for (size_t idx = 1; idx < count; idx++) {
+            Node* node = dh::codex::emplace<Node>();
+            nodes[(idx - 1) / 8]->children.push_back(node->get_id());
+            nodes.push_back(node);
+        }
+        return root;
+    }
+
+    /**
+     * @brief Removing a detached tree, remove_cascade() vs collect() on one and all threads
+     *
+     * Another tree of the same size stays reachable from a root, so collect() has to
+     * mark it and sweep the detached one.
+    */
+    void bench_collect() {
+        const size_t count = 1000000;
+        std::printf("collect (%zu live Things, %zu garbage)\n", count, count);
+        Node* live = _build_tree(count);
+        dh::codex::add_root(live);
+        {
+            Node* garbage = _build_tree(count);
+            const auto start = Clock::now();
+            dh::codex::remove_cascade(garbage);
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    %-18s %8.1f ms\n", "remove_cascade():", seconds * 1000.0);
+        }
+        for (const size_t threads : { (size_t)1, (size_t)0 }) {
+            _build_tree(count);
+            const auto start = Clock::now();
+            dh::codex::collect(threads);
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    %-18s %8.1f ms\n", threads ? "collect(1):" : "collect(0):", seconds * 1000.0);
+        }
+        dh::codex::remove_root(live);
+        dh::codex::collect();
+    }
+
+    /**
+     * @brief Walking a tree breadth first, child UUIDs kept by each Thing vs a Codex relation
+    */
+    void bench_relations() {
+        const size_t count = 1000000;
+        const size_t rounds = 5;
+        const dh::codex::Relation children = dh::codex::relation("bench_children");
+        Node* root = _build_tree(count);
+        std::vector<dh::codex::Uuid> queue{ root->get_id() };
+        for (size_t idx = 0; idx < queue.size(); idx++) {
+            Node* node = dh::codex::get<Node>(queue[idx]);
+            for (const auto& child : node->children) {
+                dh::codex::relate(queue[idx], child, children);
+                queue.push_back(child);
+            }
+        }
+
+        std::printf("relations (%zu Things)\n", count);
+        for (const bool related : { false, true }) {
+            size_t visited = 0;
+            const auto start = Clock::now();
+            for (size_t round = 0; round < rounds; round++) {
+                queue.assign(1, root->get_id());
+                for (size_t idx = 0; idx < queue.size(); idx++) {
+                    if (related) {
+                        const dh::codex::Span<dh::codex::Uuid> span = dh::codex::neighbors__unsafe(queue[idx], children);
+                        queue.insert(queue.end(), span.begin(), span.end());
+                    }
+                    else {
+                        const Node* node = dh::codex::get<Node>(queue[idx]);
+                        queue.insert(queue.end(), node->children.begin(), node->children.end());
+                    }
+                }
+                visited += queue.size();
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    %-18s %12.0f Things/s\n", related ? "neighbors():" : "Thing members:", visited / seconds);
+        }
+        dh::codex::remove_cascade(root);
+    }
+
+    /**
+     * @brief Walking a tree, get() per edge vs bfs() on one and all threads and along a relation
+    */
+    void bench_traversal() {
+        const size_t count = 1000000;
+        const size_t rounds = 5;
+        const dh::codex::Relation children = dh::codex::relation("bench_traversal");
+        Node* root = _build_tree(count);
+        for (const auto& uuid : dh::codex::bfs(root->get_id(), [](const dh::codex::Thing* thing, dh::codex::RefVisitor& visitor) { thing->visit_refs(visitor); })) {
+            for (const auto& child : dh::codex::get<Node>(uuid)->children) dh::codex::relate(uuid, child, children);
+        }
+        auto edges = [](const dh::codex::Thing* thing, dh::codex::RefVisitor& visitor) { thing->visit_refs(visitor); };
+
+        std::printf("traversal (%zu Things)\n", count);
+        auto measure = [&](const char* name, const std::function<size_t()>& walk) {
+            size_t visited = 0;
+            const auto start = Clock::now();
+            for (size_t round = 0; round < rounds; round++) visited += walk();
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    %-18s %12.0f Things/s\n", name, visited / seconds);
+        };
+        measure("get() per edge:", [&]() {
+            std::vector<dh::codex::Uuid> queue{ root->get_id() };
+            for (size_t idx = 0; idx < queue.size(); idx++) {
+                const Node* node = dh::codex::get<Node>(queue[idx]);
+                queue.insert(queue.end(), node->children.begin(), node->children.end());
+            }
+            return queue.size();
+        });
+        measure("bfs(1):", [&]() { return dh::codex::bfs(root->get_id(), edges, 1).size(); });
+        measure("bfs(0):", [&]() { return dh::codex::bfs(root->get_id(), edges).size(); });
+        measure("bfs(relation):", [&]() { return dh::codex::bfs(root->get_id(), children).size(); });
+        measure("dfs(relation):", [&]() { return dh::codex::dfs(root->get_id(), children).size(); });
+        dh::codex::remove_cascade(root);
+
+        // the helper threads have to work on the Codex of the calling thread
+        dh::codex::Codex own;
+        own.run([&]() {
+            Node* own_root = _build_tree(count);
+            measure("bfs(0), own Codex:", [&]() { return dh::codex::bfs(own_root->get_id(), edges).size(); });
+            const size_t reached = dh::codex::bfs(own_root->get_id(), edges).size();
+            dh::codex::add_root(own_root);
+            const size_t collected = dh::codex::collect();
+            std::printf("    own Codex: bfs(0) reached %zu, collect(0) removed %zu of %zu Things\n", reached, collected, count);
+        });
+    }
+
+#ifndef DH_CODEX_SINGLE_THREADED
+    /**
+     * @brief Following parent references on all threads, get<T>() of the UUID vs Ref<T>
+     *
+     * One thread keeps adding and removing unrelated Things, so Refs now and then have
+     * to look their Thing up again.
+    */
+    void bench_ref() {
+        const size_t count = 10000;
+        const size_t lookups = 2000000;
+        const size_t threads = _thread_count();
+        std::vector<dh::codex::Uuid> uuids;
+        std::vector<dh::codex::Ref<Level3>> refs;
+        for (size_t idx = 0; idx < count; idx++) {
+            uuids.push_back(dh::codex::emplace<Level5>()->get_id());
+            refs.emplace_back(uuids.back());
+        }
+
+        std::printf("ref (%zu Things, %zu threads, with churn)\n", count, threads);
+        for (const bool cached : { false, true }) {
+            std::atomic<bool> stop{ false };
+            std::thread churn([&stop]() {
+                while (!stop) dh::codex::remove(dh::codex::Thing::create());
+            });
+            std::atomic<size_t> found{ 0 };
+            std::vector<std::thread> workers;
+            const auto start = Clock::now();
+            for (size_t thread = 0; thread < threads; thread++) {
+                workers.emplace_back([&, thread]() {
+                    size_t local = 0;
+                    for (size_t idx = 0; idx < lookups; idx++) {
+                        const size_t pick = (idx * 7919 + thread) % count;
+                        local += (cached ? refs[pick].get() : dh::codex::get<Level3>(uuids[pick])) != nullptr;
+                    }
+                    found += local;
+                });
+            }
+            for (auto& worker : workers) worker.join();
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            stop = true;
+            churn.join();
+            std::printf("    %-18s %12.0f gets/s\n", cached ? "Ref<T>::get():" : "get<T>(uuid):", found / seconds);
+        }
+        for (const auto& uuid : uuids) dh::codex::remove(uuid);
+    }
+#endif
+
+    /**
+     * @brief add/remove churn on all threads, sharing the default Codex vs one Codex per thread
+    */
+    void bench_codices() {
+        const size_t threads = _thread_count();
+        const auto duration = std::chrono::milliseconds(500);
+
+        std::printf("codices (%zu threads, add/remove pairs)\n", threads);
+        for (const bool separate : { false, true }) {
+            std::atomic<bool> stop{ false };
+            std::atomic<uint64_t> pairs{ 0 };
+            std::vector<std::thread> workers;
+            for (size_t thread = 0; thread < threads; thread++) {
+                workers.emplace_back([&]() {
+                    uint64_t local = 0;
+                    auto churn = [&]() {
+                        while (!stop.load(std::memory_order_relaxed)) {
+                            dh::codex::remove(dh::codex::Thing::create());
+                            local++;
+                        }
+                    };
+                    if (separate) dh::codex::Codex().run(churn);
+                    else churn();
+                    pairs += local;
+                });
+            }
+            std::this_thread::sleep_for(duration);
+            stop = true;
+            for (auto& worker : workers) worker.join();
+
+            const double seconds = std::chrono::duration<double>(duration).count();
+            std::printf("    %-18s %12.0f pairs/s\n", separate ? "Codex per thread:" : "default Codex:", pairs.load() / seconds);
+        }
+    }
+
+    /**
+     * @brief Blocks of 100 get()s and 10 create/remove pairs, locking per call vs one Session per block
+    */
+    void bench_session() {
+        const size_t populated = 10000;
+        const size_t blocks = 20000;
+        std::vector<dh::codex::Uuid> uuids;
+        uuids.reserve(populated);
+        for (size_t idx = 0; idx < populated; idx++) uuids.push_back(dh::codex::Thing::create()->get_id());
+
+        std::printf("session (%zu Things, blocks of 100 gets and 10 add/remove pairs)\n", populated);
+        for (const bool session : { false, true }) {
+            size_t found = 0;
+            const auto start = Clock::now();
+            for (size_t block = 0; block < blocks; block++) {
+                if (session) {
+                    dh::codex::Session batch;
+                    for (size_t idx = 0; idx < 100; idx++) found += batch.get(uuids[(block * 100 + idx) % populated]) != nullptr;
+                    for (size_t idx = 0; idx < 10; idx++) batch.remove(batch.emplace<dh::codex::Thing>());
+                    batch.commit();
+                }
+                else {
+                    for (size_t idx = 0; idx < 100; idx++) found += dh::codex::get(uuids[(block * 100 + idx) % populated]) != nullptr;
+                    for (size_t idx = 0; idx < 10; idx++) dh::codex::remove(dh::codex::emplace<dh::codex::Thing>());
+                }
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("    %-18s %12.0f blocks/s (found %zu)\n", session ? "Session:" : "per call:", blocks / seconds, found);
+        }
+        for (const auto& uuid : uuids) dh::codex::remove(uuid);
+    }
+
+    const std::map<std::string, void (*)()>& _benchmarks() {
+        static const std::map<std::string, void (*)()> benchmarks = {
+            { "add_many", bench_add_many },
+            { "codices", bench_codices },
+            { "collect", bench_collect },
+            { "emplace", bench_emplace },
+            { "get_many", bench_get_many },
+            { "read_write_mix", bench_read_write_mix },
+#ifndef DH_CODEX_SINGLE_THREADED
+            { "ref", bench_ref },
+#endif
+            { "relations", bench_relations },
+            { "session", bench_session },
+            { "single_thread", bench_single_thread },
+            { "traversal", bench_traversal },
+            { "typed_get", bench_typed_get },
+            { "uuid_generation", bench_uuid_generation },
+        };
+        return benchmarks;
+    }
+};
+
+int main(int argc, char** argv) {
+    const auto& benchmarks = _benchmarks();
+    if (argc < 2) {
+        for (const auto& benchmark : benchmarks) benchmark.second();
+        return 0;
+    }
+    for (int idx = 1; idx < argc; idx++) {
+        auto it = benchmarks.find(argv[idx]);
+        if (it == benchmarks.end()) {
+            std::printf("Unknown benchmark '%s'\n", argv[idx]);
+            return 1;
+        }
+        it->second();
+    }
+    return 0;
+}
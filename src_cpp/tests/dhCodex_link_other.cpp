@@ -0,0 +1,22 @@
+/* dhCodex - C++ - link test, second translation unit
+
+See dhCodex_link_test.cpp.
+*/
+
+#include "../dhCodex.hpp"
+
+dh::codex::Thing* other_create() {
+    return dh::codex::Thing::create();
+}
+
+dh::codex::Thing* other_get(const dh::codex::Uuid& uuid) {
+    return dh::codex::get(uuid);
+}
+
+size_t other_size() {
+    return dh::codex::size();
+}
+
+dh::codex::Status other_remove(const dh::codex::Uuid& uuid) {
+    return dh::codex::remove(uuid);
+}
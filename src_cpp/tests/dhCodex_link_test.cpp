@@ -0,0 +1,75 @@
+/* dhCodex - C++ - link test
+
+Built from two translation units that both include dhCodex.hpp, this one and
+dhCodex_link_other.cpp. Both have to work on the same default Codex and see the
+same per thread state (the current Codex, the shards held), see the Makefile:
+
+    make test
+*/
+
+#include "../dhCodex.hpp"
+#include "dhCodex_test.hpp"
+
+// defined in dhCodex_link_other.cpp
+dh::codex::Thing* other_create();
+dh::codex::Thing* other_get(const dh::codex::Uuid& uuid);
+size_t other_size();
+dh::codex::Status other_remove(const dh::codex::Uuid& uuid);
+
+namespace {
+    /**
+     * @brief Things added in one translation unit can be found and removed from the other
+    */
+    void test_default_codex() {
+        dh::codex::Thing* here = dh::codex::Thing::create();
+        dh::codex::Thing* there = other_create();
+        CHECK(other_get(here->get_id()) == here);
+        CHECK(dh::codex::get(there->get_id()) == there);
+        CHECK(other_size() == dh::codex::size());
+        CHECK(other_remove(here->get_id()) == dh::codex::Status::SUCCESS);
+        CHECK(dh::codex::get(here->get_id()) == nullptr);
+        CHECK(dh::codex::remove(there) == dh::codex::Status::SUCCESS);
+        CHECK(other_get(there->get_id()) == nullptr);
+    }
+
+    /**
+     * @brief Codex::run() in one translation unit makes the Codex current for the other one as well
+    */
+    void test_current_codex() {
+        const size_t before = dh::codex::size();
+        dh::codex::Codex own;
+        dh::codex::Thing* thing = own.run([]() { return other_create(); });
+        CHECK(own.get(thing->get_id()) == thing);
+        CHECK(own.size() == 1);
+        CHECK(other_size() == before);
+        own.run([&]() { CHECK(other_size() == 1); });
+    }
+
+    /**
+     * @brief Shards locked in one translation unit count as held in the other one
+    */
+    void test_held_shards() {
+        dh::codex::Thing* thing = dh::codex::Thing::create();
+        const dh::codex::Uuid uuid = thing->get_id();
+        dh_test::finishes_within(std::chrono::seconds(10), "get() from within a Session", [&]() {
+            dh::codex::Session session;
+            CHECK(other_get(uuid) == thing);
+            CHECK(other_remove(uuid) == dh::codex::Status::SUCCESS);
+            session.commit();
+        });
+        CHECK(dh::codex::get(uuid) == nullptr);
+    }
+
+    const std::map<std::string, void (*)()>& _tests() {
+        static const std::map<std::string, void (*)()> tests = {
+            { "current_codex", test_current_codex },
+            { "default_codex", test_default_codex },
+            { "held_shards", test_held_shards },
+        };
+        return tests;
+    }
+};
+
+int main(int argc, char** argv) {
+    return dh_test::run(argc, argv, _tests());
+}
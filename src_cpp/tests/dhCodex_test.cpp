@@ -0,0 +1,1187 @@
+/* dhCodex - C++ - tests
+
+Small, dependency free tests for dhCodex.hpp. Like the benchmarks, the Codex is
+configured at compile time, so the tests are built and run once per configuration,
+see the Makefile:
+
+    make test
+
+Usage:
+    ./test              runs all tests
+    ./test <name> ...   runs the given tests only
+*/
+
+#include "../dhCodex.hpp"
+#include "dhCodex_test.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    /**
+     * @brief A Thing with children, removed along with it, see Thing::dependents()
+    */
+    class Node : public dh::codex::Thing {
+    public:
+        std::vector<dh::codex::Uuid> children;
+
+        void dependents(std::vector<dh::codex::Uuid>& out) const override {
+            out.insert(out.end(), this->children.begin(), this->children.end());
+        }
+
+        void visit_refs(dh::codex::RefVisitor& visitor) const override {
+            for (const auto& child : this->children) visitor.visit(child);
+        }
+    };
+
+    /**
+     * @brief A chain of `count` Nodes, each the only child of the one before
+    */
+    std::vector<Node*> _chain(size_t count) {
+        std::vector<Node*> nodes;
+        for (size_t idx = 0; idx < count; idx++) {
+            nodes.push_back(dh::codex::emplace<Node>());
+            if (idx > 0) nodes[idx - 1]->children.push_back(nodes[idx]->get_id());
+        }
+        return nodes;
+    }
+
+    /**
+     * @brief Things added to a Codex of its own can't be seen from the default one and the other way around
+    */
+    void test_codices() {
+        const size_t before = dh::codex::size();
+        dh::codex::Codex own;
+        dh::codex::Thing* thing = own.emplace<dh::codex::Thing>();
+        dh::codex::Thing* other = dh::codex::Thing::create();
+
+        CHECK(own.get(thing->get_id()) == thing);
+        CHECK(dh::codex::get(thing->get_id()) == nullptr);
+        CHECK(own.get(other->get_id()) == nullptr);
+        CHECK(own.size() == 1);
+        CHECK(dh::codex::size() == before + 1);
+
+        own.run([&]() { dh::codex::Thing::create(); });
+        CHECK(own.size() == 2);
+        CHECK(dh::codex::size() == before + 1);
+        dh::codex::remove(other);
+    }
+
+    /**
+     * @brief A tree below `root` with `levels` levels of 8 children per Node
+    */
+    std::vector<Node*> _tree(size_t levels) {
+        std::vector<Node*> nodes{ dh::codex::emplace<Node>() };
+        size_t begin = 0;
+        for (size_t level = 1; level < levels; level++) {
+            const size_t end = nodes.size();
+            for (size_t parent = begin; parent < end; parent++) {
+                for (size_t idx = 0; idx < 8; idx++) {
+                    nodes.push_back(dh::codex::emplace<Node>());
+                    nodes[parent]->children.push_back(nodes.back()->get_id());
+                }
+            }
+            begin = end;
+        }
+        return nodes;
+    }
+
+    /**
+     * @brief The same calls with the same results in every configuration, DH_CODEX_SINGLE_THREADED included
+    */
+    void test_workload() {
+        const size_t before = dh::codex::size();
+        const auto edges = [](const dh::codex::Thing* thing, dh::codex::RefVisitor& visitor) { thing->visit_refs(visitor); };
+        const std::vector<Node*> tree = _tree(4);
+        const std::vector<Node*> garbage = _tree(3);
+        const dh::codex::Uuid root = tree[0]->get_id();
+        CHECK(tree.size() == 585);
+        CHECK(dh::codex::size() == before + 585 + 73);
+
+        // lookups
+        const dh::codex::Handle<Node> handle = dh::codex::handle_of(tree[1]);
+        CHECK(dh::codex::get(handle) == tree[1]);
+        CHECK(dh::codex::get_handle<Node>(tree[1]->get_id()) == handle);
+        CHECK(dh::codex::get<Node>(tree[2]->get_uuid()) == tree[2]);
+        const std::vector<dh::codex::Thing*> many = dh::codex::get_many(std::vector<dh::codex::Uuid>{ root, dh::codex::Uuid::generate(), tree[584]->get_id() });
+        CHECK(many.size() == 3 && many[0] == tree[0] && many[1] == nullptr && many[2] == tree[584]);
+
+        // traversals
+        CHECK(dh::codex::bfs(root, edges, 1).size() == 585);
+        CHECK(dh::codex::bfs(root, edges, 4).size() == 585);
+        CHECK(dh::codex::dfs(root, edges).size() == 585);
+        CHECK(dh::codex::dfs(root, edges)[1] == tree[1]->get_id());
+        CHECK(dh::codex::subtree(root, edges, 1).size() == 9);
+        CHECK(dh::codex::reachable_from(root, edges).size() == 584);
+
+        // relations
+        const dh::codex::Relation children = dh::codex::relation("workload");
+        for (size_t idx = 1; idx <= 8; idx++) CHECK(dh::codex::relate(tree[0], tree[idx], children) == dh::codex::Status::SUCCESS);
+        CHECK(dh::codex::relate(root, dh::codex::Uuid::generate(), children) == dh::codex::Status::FAILURE);
+        CHECK(dh::codex::neighbors(root, children).size() == 8);
+        CHECK(dh::codex::inverse_neighbors(tree[3]->get_id(), children).size() == 1);
+        CHECK(dh::codex::bfs(root, children).size() == 9);
+        CHECK(dh::codex::unrelate(tree[0], tree[8], children) == dh::codex::Status::SUCCESS);
+        CHECK(dh::codex::neighbors(root, children).size() == 7);
+
+        // removals
+        CHECK(dh::codex::remove_many(std::vector<dh::codex::Uuid>{ tree[584]->get_id(), tree[584]->get_id() }) == 1);
+        CHECK(dh::codex::get(handle) == tree[1]);
+        dh::codex::add_root(tree[0]);
+        CHECK(dh::codex::collect(1) == 73);
+        CHECK(dh::codex::remove_root(root) == dh::codex::Status::SUCCESS);
+        CHECK(dh::codex::remove(tree[1]) == dh::codex::Status::SUCCESS);
+        CHECK(dh::codex::get(handle) == nullptr);
+        CHECK(dh::codex::neighbors(root, children).size() == 6);
+        // neither tree[1] nor tree[584] are reached anymore, the orphaned children of tree[1] are left over
+        CHECK(dh::codex::remove_cascade(root) == 1 + 7 + 7 * 8 + 7 * 64 - 1);
+        CHECK(dh::codex::size() == before + 8 + 64);
+        CHECK(dh::codex::collect(1) == 8 + 64);
+        CHECK(dh::codex::size() == before);
+    }
+
+    /**
+     * @brief bfs() and collect() with helper threads look at the Codex they were called for, not the default one
+    */
+    void test_parallel_in_codex() {
+        const size_t before = dh::codex::size();
+        const auto edges = [](const dh::codex::Thing* thing, dh::codex::RefVisitor& visitor) { thing->visit_refs(visitor); };
+        dh::codex::Codex own;
+        own.run([&]() {
+            const std::vector<Node*> tree = _tree(4);
+            const std::vector<Node*> garbage = _tree(3);
+            const dh::codex::Uuid collected = garbage.back()->get_id();
+            dh::codex::add_root(tree[0]);
+            CHECK(dh::codex::bfs(tree[0]->get_id(), edges, 0).size() == tree.size());
+            CHECK(dh::codex::bfs(garbage[0]->get_id(), edges, 0).size() == garbage.size());
+            CHECK(dh::codex::collect(0) == garbage.size());
+            CHECK(dh::codex::size() == tree.size());
+            CHECK(dh::codex::get(tree.back()->get_id()) == tree.back());
+            CHECK(dh::codex::get(collected) == nullptr);
+        });
+        CHECK(own.size() == 585);
+        CHECK(dh::codex::size() == before);
+    }
+
+#ifndef DH_CODEX_SINGLE_THREADED
+    /**
+     * @brief Parallel bfs() and collect() from two threads at once, each in its own Codex, share the worker pool
+    */
+    void test_worker_pool() {
+        const auto edges = [](const dh::codex::Thing* thing, dh::codex::RefVisitor& visitor) { thing->visit_refs(visitor); };
+        dh::codex::Codex codices[2];
+        dh_test::finishes_within(std::chrono::seconds(120), "bfs() and collect() on the worker pool", [&]() {
+            std::vector<std::thread> threads;
+            for (auto& codex : codices) {
+                threads.emplace_back([&]() {
+                    codex.run([&]() {
+                        // wide enough for the parallel paths of both
+                        const std::vector<Node*> tree = _tree(5);
+                        const std::vector<Node*> garbage = _tree(6);
+                        dh::codex::add_root(tree[0]);
+                        const std::vector<dh::codex::Uuid> expected = dh::codex::bfs(garbage[0]->get_id(), edges, 1);
+                        std::set<dh::codex::Uuid> reference(expected.begin(), expected.end());
+                        for (int round = 0; round < 3; round++) {
+                            const std::vector<dh::codex::Uuid> found = dh::codex::bfs(garbage[0]->get_id(), edges, 4);
+                            CHECK(found.size() == garbage.size());
+                            CHECK(std::set<dh::codex::Uuid>(found.begin(), found.end()) == reference);
+                            CHECK(dh::codex::bfs(tree[0]->get_id(), edges, 4).size() == tree.size());
+                        }
+                        CHECK(dh::codex::collect(4) == garbage.size());
+                        CHECK(dh::codex::size() == tree.size());
+                        CHECK(dh::codex::get(tree.back()->get_id()) == tree.back());
+                    });
+                });
+            }
+            for (auto& thread : threads) thread.join();
+        });
+        CHECK(codices[0].size() == 4681 && codices[1].size() == 4681);
+    }
+#endif
+
+    /**
+     * @brief Adjacency with random appends, erases and extracts always agrees with a std::map of vectors
+     *
+     * Enough churn to relocate segments and compact the pool many times over.
+    */
+    void test_adjacency() {
+        std::mt19937_64 rng{ 11 };
+        std::vector<dh::codex::Uuid> keys;
+        for (int idx = 0; idx < 50; idx++) keys.push_back(dh::codex::Uuid::generate());
+        std::vector<dh::codex::Uuid> neighbors;
+        for (int idx = 0; idx < 20; idx++) neighbors.push_back(dh::codex::Uuid::generate());
+
+        dh::codex::detail::Adjacency adjacency;
+        std::map<dh::codex::Uuid, std::vector<dh::codex::Uuid>> expected;
+        for (int step = 0; step < 200000; step++) {
+            const dh::codex::Uuid& key = keys[rng() % keys.size()];
+            const dh::codex::Uuid& neighbor = neighbors[rng() % neighbors.size()];
+            std::vector<dh::codex::Uuid>& list = expected[key];
+            const uint64_t op = rng() % 100;
+            if (op < 55) {
+                adjacency.append(key, neighbor);
+                list.push_back(neighbor);
+            }
+            else if (op < 98) {
+                auto it = std::find(list.begin(), list.end(), neighbor);
+                CHECK(adjacency.erase(key, neighbor) == (it != list.end()));
+                if (it != list.end()) list.erase(it);
+            }
+            else {
+                CHECK(adjacency.extract(key) == list);
+                list.clear();
+            }
+
+            if (step % 1000 != 0) continue;
+            for (const auto& each : keys) {
+                const dh::codex::Span<dh::codex::Uuid> span = adjacency.get(each);
+                CHECK(std::vector<dh::codex::Uuid>(span.begin(), span.end()) == expected[each]);
+            }
+        }
+    }
+
+    /**
+     * @brief A FlatMap with random inserts and erases always agrees with a std::map
+     *
+     * The second run only uses keys homing in the last four slots of a 64 slot table,
+     * so the probe runs wrap around and erase() has to shift entries back across the end.
+    */
+    void test_flat_map() {
+        std::mt19937_64 rng{ 7 };
+        const auto random_key = [&]() {
+            dh::codex::Uuid key;
+            key.hi = rng();
+            key.lo = rng();
+            return key;
+        };
+
+        std::vector<dh::codex::Uuid> random_keys;
+        for (int idx = 0; idx < 300; idx++) random_keys.push_back(random_key());
+        std::vector<dh::codex::Uuid> colliding_keys;
+        while (colliding_keys.size() < 40) {
+            const dh::codex::Uuid key = random_key();
+            if (((key.hash() >> 7) & 63) >= 60) colliding_keys.push_back(key);
+        }
+
+        for (const auto* keys : { &random_keys, &colliding_keys }) {
+            dh::codex::detail::FlatMap<int> map;
+            std::map<dh::codex::Uuid, int> expected;
+            map.reserve(keys->size());
+            for (int step = 0; step < 20000; step++) {
+                const dh::codex::Uuid& key = (*keys)[rng() % keys->size()];
+                if (rng() % 2 == 0) {
+                    map[key] = step;
+                    expected[key] = step;
+                }
+                else {
+                    bool found = false;
+                    const int value = map.extract(key, &found);
+                    auto it = expected.find(key);
+                    CHECK(found == (it != expected.end()));
+                    if (it != expected.end()) {
+                        CHECK(value == it->second);
+                        expected.erase(it);
+                    }
+                }
+
+                if (step % 100 != 0) continue;
+                CHECK(map.size() == expected.size());
+                for (const auto& other : *keys) {
+                    const int* value = map.find(other);
+                    auto it = expected.find(other);
+                    CHECK((value != nullptr) == (it != expected.end()));
+                    if (value != nullptr && it != expected.end()) CHECK(*value == it->second);
+                }
+                std::map<dh::codex::Uuid, int> iterated;
+                for (const auto& slot : map) iterated[slot.key] = slot.value;
+                CHECK(iterated == expected);
+            }
+            if (keys == &colliding_keys) CHECK(map.capacity() == 64);
+        }
+    }
+
+#ifndef DH_CODEX_SINGLE_THREADED
+    /**
+     * @brief A Thing whose contents tell whether it has been destroyed already
+    */
+    class Payload : public dh::codex::Thing {
+    public:
+        static constexpr uint64_t kAlive = 0x5AFE5AFE5AFE5AFEull;
+        uint64_t state = kAlive;
+
+        Payload() = default;
+        Payload(const Payload&) = default;
+        ~Payload() { this->state = 0; }
+    };
+
+    /**
+     * @brief get() on one set of UUIDs while other threads keep adding and removing them
+     *
+     * Meant to run under ThreadSanitizer as well (make tsan), readers must never see
+     * a Thing that has been destroyed or a Thing for another UUID. Without
+     * DH_CODEX_LOCKFREE_READS only the Things found through a Session are looked at.
+    */
+    void test_concurrent_get_remove() {
+        const size_t before = dh::codex::size();
+        std::vector<Payload> prototypes(256);
+        std::atomic<size_t> writing{ 4 };
+        std::atomic<size_t> broken{ 0 };
+
+        dh_test::finishes_within(std::chrono::seconds(60), "get() against add() and remove()", [&]() {
+            std::vector<std::thread> threads;
+            for (size_t writer = 0; writer < 4; writer++) {
+                threads.emplace_back([&, writer]() {
+                    for (int round = 0; round < 200; round++) {
+                        // every writer owns every fourth UUID
+                        for (size_t idx = writer; idx < prototypes.size(); idx += 4) dh::codex::add(std::make_unique<Payload>(prototypes[idx]));
+                        for (size_t idx = writer; idx < prototypes.size(); idx += 4) dh::codex::remove(prototypes[idx].get_id());
+                    }
+                    writing--;
+                });
+            }
+            for (size_t reader = 0; reader < 4; reader++) {
+                threads.emplace_back([&]() {
+                    const auto verify = [&](const Payload* thing, const Payload& prototype) {
+                        if (thing != nullptr && (thing->state != Payload::kAlive || thing->get_id() != prototype.get_id())) broken++;
+                    };
+                    for (size_t sweep = 0; writing > 0; sweep++) {
+                        if (sweep % 2 == 0) {
+                            dh::codex::Session session;
+                            for (const auto& prototype : prototypes) verify(session.get<Payload>(prototype.get_id()), prototype);
+                            continue;
+                        }
+                        dh::codex::ReadGuard guard;
+                        for (const auto& prototype : prototypes) {
+                            const Payload* thing = dh::codex::get<Payload>(prototype.get_id());
+                            // only the lock free reads keep a Thing alive after get() returned
+                            if (dh::codex::detail::kLockFreeReads) verify(thing, prototype);
+                        }
+                    }
+                });
+            }
+            for (auto& thread : threads) thread.join();
+        });
+
+        dh::codex::reclaim();
+        CHECK(broken == 0);
+        CHECK(dh::codex::size() == before);
+    }
+#endif
+
+    static std::atomic<size_t> _links_destroyed{ 0 };
+
+    /**
+     * @brief Removes the next link of its chain from its destructor
+    */
+    class Link : public dh::codex::Thing {
+    public:
+        dh::codex::Uuid next;
+        std::thread::id* last_destroyed_on = nullptr;
+
+        ~Link() {
+            _links_destroyed++;
+            if (this->last_destroyed_on != nullptr) *this->last_destroyed_on = std::this_thread::get_id();
+            if (!this->next.is_nil()) dh::codex::remove__unsafe(this->next);
+        }
+    };
+
+    /**
+     * @brief Destructors removing further Things, down a long chain
+     *
+     * With DH_CODEX_BACKGROUND_RECLAIM the destructors run on the reclaimer thread,
+     * reclaim() waits for the whole chain and the chain stays in its own Codex.
+    */
+    void test_destructor_chain() {
+        const size_t before = dh::codex::size();
+        std::thread::id last_destroyed_on;
+        dh::codex::Codex own;
+        own.run([&]() {
+            Link* head = dh::codex::emplace<Link>();
+            Link* tail = head;
+            for (int idx = 1; idx < 10000; idx++) {
+                Link* link = dh::codex::emplace<Link>();
+                tail->next = link->get_id();
+                tail = link;
+            }
+            tail->last_destroyed_on = &last_destroyed_on;
+            CHECK(dh::codex::size() == 10000);
+
+            _links_destroyed = 0;
+            CHECK(dh::codex::remove(head) == dh::codex::Status::SUCCESS);
+            dh::codex::reclaim();
+            CHECK(_links_destroyed == 10000);
+            CHECK(dh::codex::size() == 0);
+        });
+        CHECK(own.size() == 0);
+        CHECK(dh::codex::size() == before);
+        CHECK((last_destroyed_on != std::this_thread::get_id()) == dh::codex::detail::kBackgroundReclaim);
+    }
+
+    /**
+     * @brief Random UUIDs carry version 4 and the RFC 4122 variant, and survive the string round trip
+    */
+    void test_uuid_v4() {
+        std::vector<dh::codex::Uuid> uuids;
+        for (int idx = 0; idx < 1000; idx++) uuids.push_back(dh::codex::detail::_get_uuid_generator().v4());
+        for (const auto& uuid : uuids) {
+            CHECK(uuid.version() == 4);
+            CHECK((uuid.lo >> 62) == 2);
+            CHECK(dh::codex::Uuid::from_string(uuid.to_string()) == uuid);
+        }
+        std::sort(uuids.begin(), uuids.end());
+        CHECK(std::adjacent_find(uuids.begin(), uuids.end()) == uuids.end());
+    }
+
+    // only ever emplaced by test_slab_reuse(), so its pool is its own
+    class Pooled : public dh::codex::Thing {
+    public:
+        uint64_t payload[4] = {};
+    };
+
+    /**
+     * @brief Removed Things give their cells back to the pool, also when removed on another thread
+    */
+    void test_slab_reuse() {
+        const size_t before = dh::codex::size();
+        dh::codex::detail::SlabPool<Pooled>& pool = dh::codex::detail::SlabPool<Pooled>::instance();
+        const auto overlap = [](std::vector<Pooled*> first, std::vector<Pooled*> second) {
+            std::sort(first.begin(), first.end());
+            std::sort(second.begin(), second.end());
+            std::vector<Pooled*> common;
+            std::set_intersection(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(common));
+            return common.size();
+        };
+        const auto emplace_all = [](size_t count) {
+            std::vector<Pooled*> things;
+            for (size_t idx = 0; idx < count; idx++) things.push_back(dh::codex::emplace<Pooled>());
+            return things;
+        };
+        const auto remove_all = [](const std::vector<Pooled*>& things) {
+            for (auto* thing : things) dh::codex::remove(thing);
+            dh::codex::reclaim();
+        };
+
+        const std::vector<Pooled*> first = emplace_all(500);
+        const size_t slabs = pool.slabs();
+        CHECK(slabs >= 1);
+        remove_all(first);
+        const std::vector<Pooled*> second = emplace_all(500);
+        CHECK(pool.slabs() == slabs);
+        // a thread keeps a few cells for itself, a background reclaimer as well
+        CHECK(overlap(first, second) >= 400);
+        remove_all(second);
+
+        // emplaced on one thread, removed on another, emplaced again on a third
+        std::vector<Pooled*> third;
+        std::thread([&]() { third = emplace_all(500); }).join();
+        std::thread([&]() { remove_all(third); }).join();
+        std::vector<Pooled*> fourth;
+        std::thread([&]() { fourth = emplace_all(500); }).join();
+        CHECK(pool.slabs() == slabs);
+        CHECK(overlap(third, fourth) >= 400);
+        for (auto* thing : fourth) CHECK(dh::codex::get<Pooled>(thing->get_id()) == thing);
+        remove_all(fourth);
+        CHECK(dh::codex::size() == before);
+    }
+
+    /**
+     * @brief remove_cascade() down a chain far deeper than the stack would allow recursing, and across a wide fan-out
+    */
+    void test_cascade_deep_and_wide() {
+        const size_t before = dh::codex::size();
+        const std::vector<Node*> chain = _chain(100000);
+        CHECK(dh::codex::size() == before + 100000);
+        CHECK(dh::codex::remove_cascade(chain[0]->get_id()) == 100000);
+        CHECK(dh::codex::size() == before);
+
+        Node* root = dh::codex::emplace<Node>();
+        for (int idx = 0; idx < 100000; idx++) root->children.push_back(dh::codex::emplace<Node>()->get_id());
+        // shared and dangling dependents are only removed once, or not at all
+        root->children.push_back(root->children.front());
+        root->children.push_back(dh::codex::Uuid::generate());
+        CHECK(dh::codex::size() == before + 100001);
+        CHECK(dh::codex::remove_cascade(root->get_id()) == 100001);
+        CHECK(dh::codex::size() == before);
+
+        // a cycle back to the root
+        const std::vector<Node*> cycle = _chain(1000);
+        cycle.back()->children.push_back(cycle.front()->get_id());
+        CHECK(dh::codex::remove_cascade(cycle[500]->get_id()) == 1000);
+        CHECK(dh::codex::size() == before);
+    }
+
+    /**
+     * @brief What the removal hooks saw, see test_remove_hooks()
+    */
+    struct HookLog {
+        std::mutex mutex;
+        std::vector<std::pair<std::string, std::vector<const dh::codex::Thing*>>> batches;
+        std::vector<const dh::codex::Thing*> batch;    // everything removed by the call under test
+        std::vector<const dh::codex::Thing*> destroyed;
+        dh::codex::Uuid keeper;
+        size_t on_remove_calls = 0;
+        size_t problems = 0;
+
+        static HookLog& instance() {
+            static HookLog log;
+            return log;
+        }
+
+        // the rest of the batch is alive and the Things outside of it can still be found
+        void check_surroundings() {
+            std::lock_guard<std::mutex> lock{ this->mutex };
+            for (const auto* thing : this->batch) {
+                if (std::find(this->destroyed.begin(), this->destroyed.end(), thing) != this->destroyed.end()) this->problems++;
+            }
+            if (dh::codex::get(this->keeper) == nullptr) this->problems++;
+        }
+    };
+
+    template <typename Self>
+    class Hooked : public dh::codex::Thing {
+    public:
+        ~Hooked() {
+            HookLog& log = HookLog::instance();
+            std::lock_guard<std::mutex> lock{ log.mutex };
+            log.destroyed.push_back(this);
+        }
+
+        void on_remove() override {
+            HookLog::instance().on_remove_calls++;
+            HookLog::instance().check_surroundings();
+        }
+
+        void on_remove_batch(dh::codex::Thing* const* things, size_t count) override {
+            HookLog& log = HookLog::instance();
+            log.batches.emplace_back(Self::name(), std::vector<const dh::codex::Thing*>(things, things + count));
+            for (size_t idx = 0; idx < count; idx++) {
+                if (dynamic_cast<Self*>(things[idx]) == nullptr) log.problems++;
+            }
+            dh::codex::Thing::on_remove_batch(things, count);
+        }
+    };
+
+    class Leaf : public Hooked<Leaf> {
+    public:
+        static const char* name() { return "Leaf"; }
+    };
+
+    class Branch : public Hooked<Branch> {
+    public:
+        static const char* name() { return "Branch"; }
+    };
+
+    /**
+     * @brief remove_many() across two types calls on_remove_batch() once per type, before anything is destroyed
+    */
+    void test_remove_hooks() {
+        const size_t before = dh::codex::size();
+        HookLog& log = HookLog::instance();
+        dh::codex::Thing* keeper = dh::codex::Thing::create();
+        log.keeper = keeper->get_id();
+
+        std::vector<dh::codex::Thing*> things{ dh::codex::emplace<Leaf>(), dh::codex::emplace<Branch>(), dh::codex::emplace<Leaf>(),
+                                               dh::codex::emplace<Branch>(), dh::codex::emplace<Leaf>() };
+        std::vector<dh::codex::Uuid> uuids;
+        for (auto* thing : things) {
+            uuids.push_back(thing->get_id());
+            log.batch.push_back(thing);
+        }
+        CHECK(dh::codex::remove_many(uuids) == 5);
+        dh::codex::reclaim();
+
+        // grouped by type, in removal order
+        CHECK(log.batches.size() == 2);
+        CHECK(log.batches.size() == 2 && log.batches[0].first == std::string("Leaf") && log.batches[1].first == std::string("Branch"));
+        CHECK(log.batches.size() == 2 && log.batches[0].second == (std::vector<const dh::codex::Thing*>{ things[0], things[2], things[4] }));
+        CHECK(log.batches.size() == 2 && log.batches[1].second == (std::vector<const dh::codex::Thing*>{ things[1], things[3] }));
+        CHECK(log.on_remove_calls == 5);
+        CHECK(log.problems == 0);
+        CHECK(log.destroyed.size() == 5);
+
+        // a single remove() is a batch of one
+        log.batches.clear();
+        log.batch.clear();
+        dh::codex::remove(dh::codex::emplace<Branch>());
+        CHECK(log.batches.size() == 1 && log.batches[0].second.size() == 1);
+        dh::codex::remove(keeper);
+        dh::codex::reclaim();
+        CHECK(dh::codex::size() == before);
+    }
+
+    /**
+     * @brief Remembers the referents it has been told about, see link()
+    */
+    class Watcher : public dh::codex::Thing {
+    public:
+        std::vector<dh::codex::Uuid> removed;
+
+        void on_referent_removed(const dh::codex::Uuid& referent) override {
+            this->removed.push_back(referent);
+        }
+    };
+
+    std::vector<dh::codex::Uuid> _sorted(std::vector<dh::codex::Uuid> uuids) {
+        std::sort(uuids.begin(), uuids.end());
+        return uuids;
+    }
+
+    /**
+     * @brief The reverse index follows link() and unlink() and is cleaned up when either side is removed
+    */
+    void test_links() {
+        const size_t before = dh::codex::size();
+        Watcher* first = dh::codex::emplace<Watcher>();
+        Watcher* second = dh::codex::emplace<Watcher>();
+        Watcher* target = dh::codex::emplace<Watcher>();
+        const dh::codex::Uuid target_id = target->get_id();
+
+        CHECK(dh::codex::link(first, target) == dh::codex::Status::SUCCESS);
+        CHECK(dh::codex::link(second, target) == dh::codex::Status::SUCCESS);
+        CHECK(dh::codex::link(first, target) == dh::codex::Status::SUCCESS);    // already linked
+        CHECK(dh::codex::link(first->get_id(), dh::codex::Uuid::generate()) == dh::codex::Status::FAILURE);
+        CHECK(_sorted(dh::codex::referrers(target_id)) == _sorted({ first->get_id(), second->get_id() }));
+        CHECK(dh::codex::referents(first->get_id()) == std::vector<dh::codex::Uuid>{ target_id });
+        CHECK(dh::codex::referrers(first->get_id()).empty());
+
+        CHECK(dh::codex::unlink(second, target) == dh::codex::Status::SUCCESS);
+        CHECK(dh::codex::unlink(second, target) == dh::codex::Status::FAILURE);
+        CHECK(dh::codex::referrers(target_id) == std::vector<dh::codex::Uuid>{ first->get_id() });
+        CHECK(dh::codex::referents(second->get_id()).empty());
+
+        // removing the referent tells the remaining referrer, once
+        CHECK(dh::codex::remove(target) == dh::codex::Status::SUCCESS);
+        CHECK(first->removed == std::vector<dh::codex::Uuid>{ target_id });
+        CHECK(second->removed.empty());
+        CHECK(dh::codex::referrers(target_id).empty());
+        CHECK(dh::codex::referents(first->get_id()).empty());
+
+        // removing the referrer only drops its links
+        CHECK(dh::codex::link(first, second) == dh::codex::Status::SUCCESS);
+        CHECK(dh::codex::link(second, first) == dh::codex::Status::SUCCESS);
+        const dh::codex::Uuid first_id = first->get_id();
+        CHECK(dh::codex::remove(first) == dh::codex::Status::SUCCESS);
+        CHECK(second->removed == std::vector<dh::codex::Uuid>{ first_id });
+        CHECK(dh::codex::referrers(second->get_id()).empty());
+        CHECK(dh::codex::referents(second->get_id()).empty());
+        CHECK(dh::codex::referrers(first_id).empty());
+        CHECK(dh::codex::unlink(second->get_id(), first_id) == dh::codex::Status::FAILURE);
+        dh::codex::remove(second);
+        CHECK(dh::codex::size() == before);
+    }
+
+    class Base : public dh::codex::Thing {
+        DH_CODEX_THING(Base, dh::codex::Thing)
+    public:
+        int value = 1;
+    };
+
+    class Derived : public Base {
+        DH_CODEX_THING(Derived, Base)
+    public:
+        int more = 2;
+    };
+
+    // registered as well, but not related to Base
+    class Unrelated : public dh::codex::Thing {
+        DH_CODEX_THING(Unrelated, dh::codex::Thing)
+    };
+
+    /**
+     * @brief Registered types report their chain and cast without dynamic_cast, unrelated ones don't cast
+    */
+    void test_type_info() {
+        const dh::codex::TypeInfo* info = Derived::static_type_info();
+        CHECK(std::string(info->name()) == "Derived");
+        CHECK(info->depth() == 2);
+        CHECK(info->parent() == Base::static_type_info());
+        CHECK(info->parent()->parent() == dh::codex::Thing::static_type_info());
+        CHECK(info->is_a(Base::static_type_info()) && info->is_a(dh::codex::Thing::static_type_info()));
+        CHECK(!Base::static_type_info()->is_a(info));
+        CHECK(!info->is_a(Unrelated::static_type_info()));
+
+        Derived* derived = dh::codex::emplace<Derived>();
+        Base* base = dh::codex::emplace<Base>();
+        dh::codex::Thing* thing = dh::codex::Thing::create();
+        CHECK(derived->get_type_info() == info);
+        CHECK(static_cast<dh::codex::Thing*>(derived)->get_type_info() == info);
+        CHECK(base->get_type_info() == Base::static_type_info());
+        CHECK(thing->get_type_info() == dh::codex::Thing::static_type_info());
+
+        // up the chain
+        CHECK(dh::codex::thing_cast<Derived>(derived) == derived);
+        CHECK(dh::codex::thing_cast<Base>(derived) == derived);
+        CHECK(dh::codex::thing_cast<dh::codex::Thing>(derived) == derived);
+        CHECK(dh::codex::thing_cast<Base>(base) == base);
+        // down and sideways
+        CHECK(dh::codex::thing_cast<Derived>(base) == nullptr);
+        CHECK(dh::codex::thing_cast<Unrelated>(derived) == nullptr);
+        CHECK(dh::codex::thing_cast<Base>(thing) == nullptr);
+        CHECK(dh::codex::thing_cast<Base>(nullptr) == nullptr);
+        // unregistered types still go through dynamic_cast
+        CHECK(dh::codex::thing_cast<Node>(derived) == nullptr);
+
+        CHECK(dh::codex::get<Base>(derived->get_id()) == derived);
+        CHECK(dh::codex::get<Derived>(base->get_id()) == nullptr);
+        CHECK(dh::codex::get<Unrelated>(derived->get_id()) == nullptr);
+        dh::codex::remove(derived);
+        dh::codex::remove(base);
+        dh::codex::remove(thing);
+    }
+
+    /**
+     * @brief Time ordered UUIDs carry version 7 and the RFC 4122 variant and keep increasing within a millisecond
+    */
+    void test_uuid_v7() {
+        const uint64_t start = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        std::vector<dh::codex::Uuid> uuids;
+        for (int idx = 0; idx < 100000; idx++) uuids.push_back(dh::codex::Uuid::generate_v7());
+        const uint64_t end = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+        size_t same_millisecond = 0;
+        for (size_t idx = 0; idx < uuids.size(); idx++) {
+            const dh::codex::Uuid& uuid = uuids[idx];
+            const uint64_t millis = uuid.hi >> 16;
+            CHECK(uuid.version() == 7);
+            CHECK((uuid.lo >> 62) == 2);
+            // the counter may run the timestamp ahead by a bit, never behind
+            CHECK(millis >= start && millis <= end + 1);
+            if (idx == 0) continue;
+            CHECK(uuids[idx - 1] < uuid);
+            if ((uuids[idx - 1].hi >> 16) == millis) same_millisecond++;
+        }
+        // 100k UUIDs take way less than 100k milliseconds, so most share one with their predecessor
+        CHECK(same_millisecond > uuids.size() / 2);
+
+#ifdef DH_CODEX_UUID_V7
+        dh::codex::Thing* first = dh::codex::Thing::create();
+        dh::codex::Thing* second = dh::codex::Thing::create();
+        CHECK(first->get_id().version() == 7);
+        CHECK(first->get_id() < second->get_id());
+        dh::codex::remove(first);
+        dh::codex::remove(second);
+#endif
+    }
+
+    /**
+     * @brief Parsing and printing the canonical form, malformed strings give the nil UUID
+    */
+    void test_uuid_strings() {
+        const dh::codex::Uuid uuid = dh::codex::Uuid::from_string("0F8FAD5B-d9cb-469f-a165-70867728950e");
+        CHECK(uuid.hi == 0x0f8fad5bd9cb469full && uuid.lo == 0xa16570867728950eull);
+        CHECK(uuid.to_string() == "0f8fad5b-d9cb-469f-a165-70867728950e");
+        CHECK(!uuid.is_nil());
+
+        unsigned char bytes[16];
+        uuid.to_bytes(bytes);
+        CHECK(bytes[0] == 0x0f && bytes[15] == 0x0e);
+        CHECK(dh::codex::Uuid::from_bytes(bytes) == uuid);
+
+        CHECK(dh::codex::Uuid().to_string() == "00000000-0000-0000-0000-000000000000");
+        CHECK(dh::codex::Uuid::from_string("00000000-0000-0000-0000-000000000000").is_nil());
+        for (const char* bad : { "", "0f8fad5b-d9cb-469f-a165-70867728950", "0f8fad5b-d9cb-469f-a165-70867728950e0",
+                                 "0f8fad5bd9cb-469f-a165-70867728950e0", "0f8fad5b-d9cb-469f-a165-70867728950g",
+                                 "0f8fad5b+d9cb-469f-a165-70867728950e", " f8fad5b-d9cb-469f-a165-70867728950e" }) {
+            CHECK(dh::codex::Uuid::from_string(bad).is_nil());
+        }
+
+        // the Things' string getters go through the same conversion
+        dh::codex::Thing* thing = dh::codex::Thing::create();
+        CHECK(dh::codex::Uuid::from_string(thing->get_uuid()) == thing->get_id());
+        CHECK(dh::codex::get(thing->get_uuid()) == thing);
+        dh::codex::remove(thing);
+    }
+
+    /**
+     * @brief Copies of emplaced Things live on the heap and don't share the original's bookkeeping
+    */
+    void test_copies() {
+        const size_t before = dh::codex::size();
+        Node* original = dh::codex::emplace<Node>();
+        original->children.push_back(dh::codex::Uuid::generate());
+        const dh::codex::Handle<Node> handle = dh::codex::handle_of(original);
+
+        std::unique_ptr<Node> copy{ new Node(*original) };
+        CHECK(copy->get_id() == original->get_id());
+        CHECK(copy->children == original->children);
+        CHECK(copy->get_handle().is_null());
+
+        // replaces the original, and is deleted rather than handed to the original's pool
+        Node* added = dh::codex::add(std::move(copy));
+        CHECK(dh::codex::get(handle) == nullptr);
+        CHECK(dh::codex::get(added->get_id()) == added);
+        CHECK(!added->get_handle().is_null() && added->get_handle() != dh::codex::Handle<dh::codex::Thing>(handle));
+        CHECK(dh::codex::remove(added) == dh::codex::Status::SUCCESS);
+
+        // sliced down to a plain Thing
+        Node* node = dh::codex::emplace<Node>();
+        const dh::codex::Uuid uuid = node->get_id();
+        dh::codex::add(std::unique_ptr<dh::codex::Thing>(new dh::codex::Thing(*node)));
+        CHECK(dh::codex::get<Node>(uuid) == nullptr && dh::codex::get(uuid) != nullptr);
+        CHECK(dh::codex::remove(uuid) == dh::codex::Status::SUCCESS);
+
+        // the pool only ever got its own cells back
+        std::vector<Node*> nodes;
+        for (int idx = 0; idx < 100; idx++) nodes.push_back(dh::codex::emplace<Node>());
+        for (auto* each : nodes) dh::codex::remove(each);
+        CHECK(dh::codex::size() == before);
+    }
+
+    /**
+     * @brief add_many() with a UUID listed twice keeps the last Thing, like consecutive add() calls
+    */
+    void test_add_many_duplicates() {
+        dh::codex::Thing* existing = dh::codex::Thing::create();
+        const dh::codex::Uuid uuid = existing->get_id();
+        const size_t before = dh::codex::size();
+
+        std::vector<std::unique_ptr<dh::codex::Thing>> batch;
+        batch.push_back(std::make_unique<dh::codex::Thing>(*existing));    // same UUID
+        batch.push_back(std::make_unique<dh::codex::Thing>());
+        batch.push_back(std::make_unique<dh::codex::Thing>(*existing));
+        dh::codex::Thing* last = batch[2].get();
+        const std::vector<dh::codex::Thing*> added = dh::codex::add_many(std::move(batch));
+
+        CHECK(added.size() == 3);
+        CHECK(added[0] == nullptr);
+        CHECK(added[1] != nullptr && dh::codex::get(added[1]->get_id()) == added[1]);
+        CHECK(added[2] == last);
+        CHECK(dh::codex::get(uuid) == last);
+        CHECK(dh::codex::size() == before + 1);
+        dh::codex::remove(uuid);
+        dh::codex::remove(added[1]);
+    }
+
+    /**
+     * @brief neighbors() and inverse_neighbors() after many relate() and unrelate() calls, checked against std::multiset
+    */
+    void test_relation_churn() {
+        const size_t before = dh::codex::size();
+        const dh::codex::Relation relation = dh::codex::relation("churn");
+        std::mt19937_64 rng{ 13 };
+        std::vector<dh::codex::Uuid> things;
+        for (int idx = 0; idx < 30; idx++) things.push_back(dh::codex::Thing::create()->get_id());
+
+        std::map<dh::codex::Uuid, std::multiset<dh::codex::Uuid>> out;
+        std::map<dh::codex::Uuid, std::multiset<dh::codex::Uuid>> in;
+        const auto as_set = [](const dh::codex::Neighbors& span) { return std::multiset<dh::codex::Uuid>(span.begin(), span.end()); };
+        const auto check_all = [&]() {
+            for (const auto& thing : things) {
+                CHECK(as_set(dh::codex::neighbors(thing, relation)) == out[thing]);
+                CHECK(as_set(dh::codex::inverse_neighbors(thing, relation)) == in[thing]);
+            }
+        };
+
+        for (int cycle = 0; cycle < 50000; cycle++) {
+            const dh::codex::Uuid& from = things[rng() % things.size()];
+            const dh::codex::Uuid& to = things[rng() % things.size()];
+            if (rng() % 2 == 0) {
+                CHECK(dh::codex::relate(from, to, relation) == dh::codex::Status::SUCCESS);
+                out[from].insert(to);
+                in[to].insert(from);
+            }
+            else {
+                auto it = out[from].find(to);
+                CHECK((dh::codex::unrelate(from, to, relation) == dh::codex::Status::SUCCESS) == (it != out[from].end()));
+                if (it == out[from].end()) continue;
+                out[from].erase(it);
+                in[to].erase(in[to].find(from));
+            }
+            if (cycle % 5000 == 0) check_all();
+        }
+        check_all();
+
+        // removing a Thing drops its edges in both directions
+        const dh::codex::Uuid removed = things.back();
+        things.pop_back();
+        dh::codex::remove(removed);
+        out.erase(removed);
+        in.erase(removed);
+        for (auto& entry : out) entry.second.erase(removed);
+        for (auto& entry : in) entry.second.erase(removed);
+        check_all();
+        CHECK(dh::codex::neighbors(removed, relation).empty() && dh::codex::inverse_neighbors(removed, relation).empty());
+        for (const auto& thing : things) dh::codex::remove(thing);
+        CHECK(dh::codex::size() == before);
+    }
+
+#ifndef DH_CODEX_SINGLE_THREADED
+    /**
+     * @brief Walking neighbors() with get() per neighbor while another thread relates and unrelates
+     *
+     * The reader holds the relation's read lock while get() locks a shard, relate()
+     * needs both as well. Both have to take them in the same order.
+    */
+    void test_relation_lock_order() {
+        const dh::codex::Relation children = dh::codex::relation("lock_order");
+        dh::codex::Thing* root = dh::codex::Thing::create();
+        std::vector<dh::codex::Thing*> things;
+        for (size_t idx = 0; idx < 16; idx++) {
+            things.push_back(dh::codex::Thing::create());
+            dh::codex::relate(root, things.back(), children);
+        }
+
+        dh_test::finishes_within(std::chrono::seconds(10), "neighbors() + get() against relate()", [&]() {
+            std::atomic<bool> stop{ false };
+            std::thread writer([&]() {
+                for (size_t round = 0; !stop; round++) {
+                    dh::codex::Thing* thing = things[round % things.size()];
+                    dh::codex::relate(root, thing, children);
+                    dh::codex::unrelate(root, thing, children);
+                }
+            });
+            size_t missing = 0;
+            const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+            while (std::chrono::steady_clock::now() < end) {
+                const dh::codex::Neighbors neighbors = dh::codex::neighbors(root->get_id(), children);
+                for (const auto& uuid : neighbors) missing += dh::codex::get(uuid) == nullptr;
+            }
+            stop = true;
+            writer.join();
+            CHECK(missing == 0);
+        });
+
+        CHECK(dh::codex::neighbors(root->get_id(), children).size() == things.size());
+        CHECK(dh::codex::bfs(root->get_id(), children).size() == things.size() + 1);
+        for (auto* thing : things) dh::codex::remove(thing);
+        CHECK(dh::codex::neighbors(root->get_id(), children).size() == 0);
+        dh::codex::remove(root);
+    }
+#endif
+
+    /**
+     * @brief remove_cascade_incremental() hides the root and its whole subtree right away, the slices unlink it
+    */
+    void test_incremental_cascade() {
+        const size_t before = dh::codex::size();
+        const std::vector<Node*> nodes = _chain(100);
+        std::vector<dh::codex::Uuid> uuids;
+        for (const auto* node : nodes) uuids.push_back(node->get_id());
+        const dh::codex::Handle<Node> grandchild = dh::codex::handle_of(nodes[2]);
+        const dh::codex::Ref<Node> last{ uuids[99] };
+        CHECK(last.get() == nodes[99]);
+
+        CHECK(dh::codex::remove_cascade_incremental(uuids[0]) == dh::codex::Status::SUCCESS);
+        CHECK(dh::codex::incremental_pending());
+        CHECK(dh::codex::get(uuids[0]) == nullptr);
+        // not unlinked by a slice yet, but pending
+        CHECK(dh::codex::get(uuids[2]) == nullptr);
+        CHECK(dh::codex::get(grandchild) == nullptr);
+        CHECK(last.get() == nullptr);
+        CHECK(dh::codex::get_many(std::vector<dh::codex::Uuid>(uuids.begin() + 1, uuids.end())) == std::vector<dh::codex::Thing*>(99, nullptr));
+        CHECK(dh::codex::size() == before + 99);
+
+        size_t slices = 0;
+        while (dh::codex::incremental_step(dh::codex::Budget(8))) {
+            slices++;
+            for (const auto& uuid : uuids) CHECK(dh::codex::get(uuid) == nullptr);
+        }
+        CHECK(slices > 1);
+        CHECK(!dh::codex::incremental_pending());
+        for (const auto& uuid : uuids) CHECK(dh::codex::get(uuid) == nullptr);
+        CHECK(dh::codex::size() == before);
+    }
+
+    /**
+     * @brief rollback() restores what a Session removed or replaced and removes what it added
+    */
+    void test_session_rollback() {
+        Node* original = dh::codex::emplace<Node>();
+        original->children.push_back(dh::codex::Uuid::generate());
+        const dh::codex::Uuid uuid = original->get_id();
+        dh::codex::Thing* removed = dh::codex::Thing::create();
+        const size_t before = dh::codex::size();
+
+        dh::codex::Uuid added;
+        {
+            dh::codex::Session session;
+            // same UUID, replaces the original
+            Node* replacement = session.add(std::make_unique<Node>(*original));
+            replacement->children.clear();
+            CHECK(session.get<Node>(uuid) == replacement);
+            CHECK(session.remove(removed) == dh::codex::Status::SUCCESS);
+            added = session.emplace<dh::codex::Thing>()->get_id();
+            // added and removed again within the Session
+            session.remove(session.emplace<dh::codex::Thing>());
+            CHECK(session.size() == before);
+            session.rollback();
+
+            CHECK(session.get<Node>(uuid) == original);
+            CHECK(session.get(removed->get_id()) == removed);
+            CHECK(session.get(added) == nullptr);
+        }
+        CHECK(dh::codex::get<Node>(uuid) == original);
+        CHECK(original->children.size() == 1);
+        CHECK(dh::codex::size() == before);
+
+        {
+            dh::codex::Session session;
+            session.add(std::make_unique<Node>(*original));
+            session.commit();
+        }
+        CHECK(dh::codex::get<Node>(uuid) != nullptr);
+        CHECK(dh::codex::size() == before);
+        dh::codex::remove(uuid);
+        dh::codex::remove(removed);
+    }
+
+#ifndef DH_CODEX_SINGLE_THREADED
+    /**
+     * @brief Readers of a SharedMutex keep making progress while writers lock it back to back
+    */
+    void test_shared_mutex() {
+        dh::codex::detail::SharedMutex mutex;
+        int64_t first = 0;
+        int64_t second = 0;
+        std::atomic<size_t> reading{ 4 };
+        std::atomic<size_t> torn{ 0 };
+        std::atomic<size_t> writes{ 0 };
+
+        dh_test::finishes_within(std::chrono::seconds(60), "readers against back to back writers", [&]() {
+            std::vector<std::thread> threads;
+            for (size_t writer = 0; writer < 4; writer++) {
+                threads.emplace_back([&]() {
+                    while (reading > 0) {
+                        mutex.lock();
+                        first++;
+                        second++;
+                        mutex.unlock();
+                        writes++;
+                    }
+                });
+            }
+            for (size_t reader = 0; reader < 4; reader++) {
+                threads.emplace_back([&]() {
+                    for (int round = 0; round < 20000; round++) {
+                        mutex.lock_shared();
+                        if (first != second) torn++;
+                        mutex.unlock_shared();
+                    }
+                    reading--;
+                });
+            }
+            for (auto& thread : threads) thread.join();
+        });
+
+        CHECK(torn == 0);
+        CHECK(writes > 0);
+        CHECK(first == static_cast<int64_t>(writes.load()) && second == first);
+
+        // a reader that queued up behind a writer gets in before the writer queued up after it
+        std::mutex order_mutex;
+        std::vector<std::string> order;
+        const auto record = [&](const char* who) {
+            std::lock_guard<std::mutex> lock{ order_mutex };
+            order.push_back(who);
+        };
+        mutex.lock();
+        std::thread reader{ [&]() {
+            mutex.lock_shared();
+            record("reader");
+            mutex.unlock_shared();
+        } };
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::thread writer{ [&]() {
+            mutex.lock();
+            record("writer");
+            mutex.unlock();
+        } };
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        mutex.unlock();
+        reader.join();
+        writer.join();
+        CHECK(order == std::vector<std::string>({ "reader", "writer" }));
+    }
+#endif
+
+    /**
+     * @brief A Ref stops returning a Thing once it has been removed or replaced
+    */
+    void test_ref_invalidation() {
+        Node* node = dh::codex::emplace<Node>();
+        const dh::codex::Uuid uuid = node->get_id();
+        const dh::codex::Ref<Node> ref{ uuid };
+        const dh::codex::Ref<Node> copy = ref;
+        CHECK(ref.get() == node);
+        CHECK(copy.get() == node);
+        CHECK(dh::codex::Ref<Node>(ref.to_string()) == ref);
+
+        // same UUID, replaces the Thing the Ref has cached
+        Node* replacement = dh::codex::add(std::make_unique<Node>(*node));
+        CHECK(ref.get() == replacement);
+        std::vector<std::unique_ptr<Node>> batch;
+        batch.push_back(std::make_unique<Node>(*replacement));    // node is gone already
+        replacement = dh::codex::add_many(std::move(batch))[0];
+        CHECK(ref.get() == replacement);
+
+        // removals elsewhere in the shard only cost a lookup
+        dh::codex::remove(dh::codex::Thing::create());
+        CHECK(ref.get() == replacement);
+
+        dh::codex::remove(uuid);
+        CHECK(ref.get() == nullptr);
+        CHECK(copy.get() == nullptr);
+        CHECK(!ref);
+
+        // cached in one Codex, not valid in another
+        dh::codex::Codex own;
+        dh::codex::Thing* thing = own.emplace<dh::codex::Thing>();
+        const dh::codex::Ref<> other{ thing->get_id() };
+        CHECK(own.run([&]() { return other.get(); }) == thing);
+        CHECK(other.get() == nullptr);
+    }
+
+    const std::map<std::string, void (*)()>& _tests() {
+        static const std::map<std::string, void (*)()> tests = {
+            { "add_many_duplicates", test_add_many_duplicates },
+            { "adjacency", test_adjacency },
+            { "cascade_deep_and_wide", test_cascade_deep_and_wide },
+            { "codices", test_codices },
+#ifndef DH_CODEX_SINGLE_THREADED
+            { "concurrent_get_remove", test_concurrent_get_remove },
+#endif
+            { "copies", test_copies },
+            { "destructor_chain", test_destructor_chain },
+            { "flat_map", test_flat_map },
+            { "incremental_cascade", test_incremental_cascade },
+            { "links", test_links },
+            { "parallel_in_codex", test_parallel_in_codex },
+            { "ref_invalidation", test_ref_invalidation },
+            { "relation_churn", test_relation_churn },
+#ifndef DH_CODEX_SINGLE_THREADED
+            { "relation_lock_order", test_relation_lock_order },
+#endif
+            { "remove_hooks", test_remove_hooks },
+            { "session_rollback", test_session_rollback },
+#ifndef DH_CODEX_SINGLE_THREADED
+            { "shared_mutex", test_shared_mutex },
+#endif
+            { "slab_reuse", test_slab_reuse },
+            { "type_info", test_type_info },
+            { "uuid_strings", test_uuid_strings },
+            { "uuid_v4", test_uuid_v4 },
+            { "uuid_v7", test_uuid_v7 },
+#ifndef DH_CODEX_SINGLE_THREADED
+            { "worker_pool", test_worker_pool },
+#endif
+            { "workload", test_workload },
+        };
+        return tests;
+    }
+};
+
+int main(int argc, char** argv) {
+    return dh_test::run(argc, argv, _tests());
+}
@@ -0,0 +1,79 @@
+/* dhCodex - C++ - test helpers
+
+Shared by the test programs, see dhCodex_test.cpp.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dh_test {
+    inline int& failures() {
+        static int count = 0;
+        return count;
+    }
+
+    inline void check(bool condition, const char* expression, const char* file, int line) {
+        if (condition) return;
+        std::printf("    %s:%d: CHECK(%s) failed\n", file, line, expression);
+        failures()++;
+    }
+
+    /**
+     * @brief Runs `function` on a thread of its own and gives up on the whole program if it hangs
+     *
+     * A deadlock can't be recovered from, so the test program exits with an error
+     * instead of hanging forever.
+    */
+    template <typename F>
+    void finishes_within(std::chrono::seconds timeout, const char* what, F function) {
+        std::atomic<bool> done{ false };
+        std::thread thread([&]() {
+            function();
+            done = true;
+        });
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!done && std::chrono::steady_clock::now() < deadline) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (!done) {
+            std::printf("    %s didn't finish within %llds, deadlocked?\n", what, (long long)timeout.count());
+            std::fflush(stdout);
+            std::_Exit(1);
+        }
+        thread.join();
+    }
+
+    /**
+     * @brief Runs the tests named on the command line, or all of them
+     *
+     * @return The exit code for main()
+    */
+    inline int run(int argc, char** argv, const std::map<std::string, void (*)()>& tests) {
+        std::vector<std::string> names;
+        if (argc < 2) {
+            for (const auto& test : tests) names.push_back(test.first);
+        }
+        for (int idx = 1; idx < argc; idx++) names.push_back(argv[idx]);
+
+        for (const auto& name : names) {
+            auto it = tests.find(name);
+            if (it == tests.end()) {
+                std::printf("Unknown test '%s'\n", name.c_str());
+                return 1;
+            }
+            const int before = failures();
+            it->second();
+            std::printf("%-28s %s\n", name.c_str(), (failures() == before) ? "ok" : "FAILED");
+            std::fflush(stdout);
+        }
+        return (failures() == 0) ? 0 : 1;
+    }
+};
+
+#define CHECK(condition) ::dh_test::check((condition), #condition, __FILE__, __LINE__)